@@ -0,0 +1,238 @@
+/*
+ * fdtgen - generate static C++ tables from a flattened device tree blob
+ *
+ * Copyright 2020 Patrick Oppenlander <patrick.oppenlander@gmail.com>
+ *
+ * SPDX-License-Identifier: 0BSD
+ *
+ * Usage: fdtgen [-n namespace] [-o output] input.dtb
+ *
+ * Writes a header defining the tree as constexpr fdt::static_node tables in
+ * the namespace, which defaults to the input file name with characters which
+ * can't appear in identifiers replaced by '_'. The header defines:
+ *
+ *	root		the root node
+ *	labels::*	nodes named by labels in /__symbols__
+ *
+ * The tables themselves are in the nested dtl namespace.
+ */
+#include "libfdt++.h"
+
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+/*
+ * literal - format string as C++ string literal
+ *
+ * Octal escapes are always three digits so they can't run into the next
+ * character.
+ */
+std::string
+literal(std::string_view s)
+{
+	std::string r{'"'};
+	for (const unsigned char c : s) {
+		if (c == '"' || c == '\\') {
+			r += '\\';
+			r += c;
+		} else if (std::isprint(c))
+			r += c;
+		else {
+			char b[5];
+			snprintf(b, sizeof(b), "\\%03o", c);
+			r += b;
+		}
+	}
+	return r += '"';
+}
+
+/*
+ * identifier - make C++ identifier from name
+ */
+std::string
+identifier(std::string_view s)
+{
+	std::string r;
+	for (const unsigned char c : s)
+		r += std::isalnum(c) ? c : '_';
+	if (empty(r) || std::isdigit(static_cast<unsigned char>(r[0])))
+		r.insert(0, 1, '_');
+	return r;
+}
+
+/*
+ * generate - write header for tree
+ *
+ * Nodes are numbered breadth first so the subnodes of each node are
+ * contiguous in the node table.
+ */
+void
+generate(std::ostream &o, const fdt::fdt &f, std::string_view ns,
+	 std::string_view source)
+{
+	std::vector<const fdt::node *> nodes;
+	std::unordered_map<const fdt::node *, size_t> index;
+	std::vector<size_t> first, count;
+	std::deque<const fdt::node *> q{&root(f)};
+	while (!empty(q)) {
+		const auto &n{*q.front()};
+		q.pop_front();
+		index.emplace(&n, size(nodes));
+		nodes.push_back(&n);
+		first.push_back(size(nodes) + size(q));
+		count.push_back(0);
+		for (const auto &sn : subnodes(n)) {
+			q.push_back(&sn);
+			++count.back();
+		}
+	}
+
+	o << "/* generated by fdtgen from " << source << ", do not edit */\n"
+	  << "#pragma once\n\n"
+	  << "#include \"libfdt++.h\"\n\n"
+	  << "namespace " << ns << " {\n\n"
+	  << "namespace dtl {\n";
+
+	std::vector<bool> has_properties(size(nodes)), has_reg(size(nodes)),
+			  has_compatible(size(nodes));
+	for (size_t i{0}; i != size(nodes); ++i) {
+		const auto &n{*nodes[i]};
+		for (const auto &p : properties(n)) {
+			if (!has_properties[i]) {
+				has_properties[i] = true;
+				o << "\ninline constexpr fdt::static_property p"
+				  << i << "[]{\n";
+			}
+			const auto &v{as_bytes(p)};
+			o << "\t{" << literal(name(p)) << ", {"
+			  << literal({reinterpret_cast<const char *>(data(v)),
+				      size(v)})
+			  << ", " << size(v) << "}},\n";
+		}
+		if (has_properties[i])
+			o << "};\n";
+		std::vector<fdt::region> r;
+		if (parent(n) && try_get_property(n, "reg")) {
+			try {
+				r = reg(n);
+			} catch (const std::invalid_argument &e) {
+				/* not addressable in root address space */
+				std::cerr << "fdtgen: warning: " << path(n)
+					  << ": no reg: " << e.what() << '\n';
+			}
+		}
+		if (!empty(r)) {
+			has_reg[i] = true;
+			o << "\ninline constexpr fdt::region r" << i << "[]{\n";
+			for (const auto &[a, s] : r)
+				o << "\t{0x" << std::hex << a << ", 0x" << s
+				  << std::dec << "},\n";
+			o << "};\n";
+		}
+		const auto &cp{try_get_property(n, "compatible")};
+		if (cp && is_stringlist(*cp)) {
+			has_compatible[i] = true;
+			o << "\ninline constexpr std::string_view c" << i
+			  << "[]{\n";
+			for (const auto &s : as_stringlist(*cp))
+				o << "\t" << literal(s) << ",\n";
+			o << "};\n";
+		}
+	}
+
+	o << "\ninline constexpr fdt::static_node nodes[" << size(nodes)
+	  << "]{\n";
+	for (size_t i{0}; i != size(nodes); ++i) {
+		const auto &n{*nodes[i]};
+		const auto &pn{parent(n)};
+		o << "\t{" << literal(name(n)) << ", ";
+		if (pn)
+			o << "&nodes[" << index.at(&pn->get()) << "], ";
+		else
+			o << "nullptr, ";
+		if (count[i])
+			o << "{&nodes[" << first[i] << "], " << count[i] << "}, ";
+		else
+			o << "{}, ";
+		o << (has_properties[i] ? "p" + std::to_string(i) : "{}")
+		  << ", "
+		  << (has_reg[i] ? "r" + std::to_string(i) : "{}") << ", "
+		  << (has_compatible[i] ? "c" + std::to_string(i) : "{}")
+		  << "},\n";
+	}
+	o << "};\n\n"
+	  << "}\n\n"
+	  << "inline constexpr const fdt::static_node &root{dtl::nodes[0]};\n";
+
+	const auto &sym{try_get_node(f, "/__symbols__")};
+	if (sym) {
+		o << "\nnamespace labels {\n\n";
+		for (const auto &p : properties(sym->get())) {
+			const auto &t{find(f, as_string(p))};
+			if (!t || !is_node(*t))
+				continue;
+			o << "inline constexpr const fdt::static_node &"
+			  << identifier(name(p)) << "{dtl::nodes["
+			  << index.at(&as_node(t->get())) << "]};\n";
+		}
+		o << "\n}\n";
+	}
+
+	o << "\n}\n";
+}
+
+void
+usage(const char *argv0)
+{
+	std::cerr << "usage: " << argv0
+		  << " [-n namespace] [-o output] input.dtb\n";
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+	std::string ns, out;
+	for (int c; (c = getopt(argc, argv, "n:o:")) != -1;) {
+		switch (c) {
+		case 'n':
+			ns = optarg;
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 2;
+	}
+	const std::string_view in{argv[optind]};
+	if (empty(ns))
+		ns = identifier(in.substr(in.rfind('/') + 1));
+
+	try {
+		const auto &f{fdt::load(std::string{in})};
+		std::ostringstream s;
+		generate(s, f, ns, in);
+		if (empty(out))
+			std::cout << s.str();
+		else if (!(std::ofstream{out} << s.str()))
+			throw std::runtime_error{"failed to write " + out};
+	} catch (const std::exception &e) {
+		std::cerr << argv[0] << ": " << e.what() << '\n';
+		return 1;
+	}
+}
@@ -8,14 +8,33 @@
 #include "libfdt++.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <system_error>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #ifdef _MSC_VER
 #include <io.h>
 #else
 #include <unistd.h>
 #endif
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FDT_X86_DISPATCH
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 extern "C" {
 #include <libfdt.h>
@@ -36,13 +55,191 @@ operator""_byte(unsigned long long v)
 }
 
 /*
- * is_0_byte - test if byte is equal to 0_byte
+ * kind_* - property value string classification
+ */
+enum : uint8_t {
+	kind_valid = 1,
+	kind_string = 2,
+	kind_stringlist = 4,
+};
+
+/*
+ * any_nonzero - test if any byte in range is not zero
+ *
+ * Compares a word at a time.
  */
-constexpr
 bool
-is_0_byte(std::byte v)
+any_nonzero(const std::byte *p, size_t n)
+{
+	for (; n >= sizeof(uint64_t); p += sizeof(uint64_t), n -= sizeof(uint64_t)) {
+		uint64_t w;
+		memcpy(&w, p, sizeof(w));
+		if (w)
+			return true;
+	}
+	return std::find_if(p, p + n, [](auto b) { return b != 0_byte; }) != p + n;
+}
+
+/*
+ * classify_value - classify property value as string and/or stringlist
+ *
+ * A string must be null terminated with no embedded nulls.
+ *
+ * A stringlist must be null terminated, may have embedded nulls and must
+ * not be all null.
+ */
+uint8_t
+classify_value(std::span<const std::byte> v)
+{
+	if (size(v) < 2 || v.back() != 0_byte)
+		return kind_valid;
+	const auto n{size(v) - 1};
+	const auto z{static_cast<const std::byte *>(memchr(data(v), 0, n))};
+	if (!z)
+		return kind_valid | kind_string | kind_stringlist;
+	if (z != data(v) || any_nonzero(z, n))
+		return kind_valid | kind_stringlist;
+	return kind_valid;
+}
+
+/*
+ * next_generation - get a new tree generation number
+ *
+ * Generation numbers are unique across all trees.
+ */
+uint64_t
+next_generation()
+{
+	static std::atomic<uint64_t> g;
+	return ++g;
+}
+
+/*
+ * alloc_value - allocate storage for a property value from r
+ */
+std::shared_ptr<std::byte[]>
+alloc_value(size_t sz, std::pmr::memory_resource *r)
+{
+	if (!sz)
+		return nullptr;
+	const std::pmr::polymorphic_allocator<std::byte> a{r};
+#ifdef __cpp_lib_smart_ptr_for_overwrite
+	return std::allocate_shared_for_overwrite<std::byte[]>(a, sz);
+#else
+	return std::allocate_shared<std::byte[]>(a, sz);
+#endif
+}
+
+#if defined(FDT_X86_DISPATCH)
+/*
+ * byteswap_mask - pshufb mask reversing each W byte value in 16 bytes
+ */
+template<size_t W>
+__m128i
+byteswap_mask()
+{
+	alignas(16) std::array<char, 16> m;
+	for (size_t i{0}; i != size(m); ++i)
+		m[i] = static_cast<char>(i / W * W + W - 1 - i % W);
+	return _mm_load_si128(reinterpret_cast<const __m128i *>(data(m)));
+}
+
+/*
+ * byteswap_ssse3, byteswap_avx2 - reverse W byte values in whole vectors
+ *
+ * These are compiled for their instruction set whatever the target flags
+ * and return the number of bytes converted.
+ */
+template<size_t W>
+[[gnu::target("ssse3")]] size_t
+byteswap_ssse3(std::byte *d, const std::byte *s, size_t sz)
+{
+	const auto m{byteswap_mask<W>()};
+	size_t i{0};
+	for (; i + 16 <= sz; i += 16) {
+		auto v{_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i))};
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(d + i),
+				 _mm_shuffle_epi8(v, m));
+	}
+	return i;
+}
+
+template<size_t W>
+[[gnu::target("avx2")]] size_t
+byteswap_avx2(std::byte *d, const std::byte *s, size_t sz)
 {
-	return v == 0_byte;
+	const auto m{_mm256_broadcastsi128_si256(byteswap_mask<W>())};
+	size_t i{0};
+	for (; i + 32 <= sz; i += 32) {
+		auto v{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i))};
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i),
+				    _mm256_shuffle_epi8(v, m));
+	}
+	return i;
+}
+
+/*
+ * x86_simd - best byte shuffle supported by the running CPU
+ */
+enum class x86_simd { none, ssse3, avx2 };
+
+x86_simd
+cpu_simd()
+{
+	static const auto r{[] {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return x86_simd::avx2;
+		if (__builtin_cpu_supports("ssse3"))
+			return x86_simd::ssse3;
+		return x86_simd::none;
+	}()};
+	return r;
+}
+#endif
+
+/*
+ * byteswap_values - copy n values of W bytes reversing byte order
+ */
+template<size_t W>
+void
+byteswap_values(std::byte *d, const std::byte *s, size_t n)
+{
+	using U = std::conditional_t<W == 2, uint16_t,
+		  std::conditional_t<W == 4, uint32_t, uint64_t>>;
+	static_assert(sizeof(U) == W);
+
+	const auto sz{n * W};
+	size_t i{0};
+#if defined(FDT_X86_DISPATCH)
+	switch (cpu_simd()) {
+	case x86_simd::avx2:
+		i = byteswap_avx2<W>(d, s, sz);
+		[[fallthrough]];
+	case x86_simd::ssse3:
+		i += byteswap_ssse3<W>(d + i, s + i, sz - i);
+		break;
+	case x86_simd::none:
+		break;
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 16 <= sz; i += 16) {
+		auto v{vld1q_u8(reinterpret_cast<const uint8_t *>(s + i))};
+		if constexpr (W == 2)
+			v = vrev16q_u8(v);
+		else if constexpr (W == 4)
+			v = vrev32q_u8(v);
+		else
+			v = vrev64q_u8(v);
+		vst1q_u8(reinterpret_cast<uint8_t *>(d + i), v);
+	}
+#endif
+	for (; i != sz; i += W) {
+		U v;
+		std::memcpy(&v, s + i, W);
+		v = dtl::byteswap(v);
+		std::memcpy(d + i, &v, W);
+	}
 }
 
 /*
@@ -140,12 +337,39 @@ fdt_finish(std::vector<std::byte> &d)
 }
 
 /*
- * load - load FDT node from d starting at node_offset into n
+ * valid_property_char - test if character is allowed in property name
+ */
+bool
+valid_property_char(char c)
+{
+	return dtl::name_chars[static_cast<unsigned char>(c)] & dtl::property_char;
+}
+
+/*
+ * check_property_name - throw if name is not a valid property name
+ */
+void
+check_property_name(std::string_view name)
+{
+	if (size(name) > 31)
+		throw std::invalid_argument{"property name too long"};
+	if (std::find_if_not(begin(name), end(name), valid_property_char) !=
+	    end(name))
+		throw std::invalid_argument{"invalid property name"};
+}
+
+/*
+ * load_properties - load properties of FDT node at node_offset into n
+ *
+ * fdt_check_full does not check names, so each name in the strings block
+ * is checked the first time it is used and marked in checked.
  */
 void
-load(std::span<const std::byte> d, const int node_offset, node &n)
+load_properties(std::span<const std::byte> d, const int node_offset, node &n,
+		std::pmr::vector<bool> &checked)
 {
 	const void *p = data(d);
+	const auto strings{static_cast<const char *>(p) + fdt_off_dt_strings(p)};
 	int off;
 
 	fdt_for_each_property_offset(off, p, node_offset) {
@@ -156,17 +380,46 @@ load(std::span<const std::byte> d, const int node_offset, node &n)
 			throw std::invalid_argument{fdt_strerror(len)};
 		std::span<const std::byte> value(
 			reinterpret_cast<const std::byte *>(val), len);
-		add_property(n, name, std::move(value));
+		if (const auto no{static_cast<size_t>(name - strings)};
+		    !checked[no]) {
+			check_property_name(name);
+			checked[no] = true;
+		}
+		set(n.add<property>(name, dtl::trusted), value);
 	}
 	if (off < 0 && off != -FDT_ERR_NOTFOUND)
 		throw std::invalid_argument{fdt_strerror(off)};
+}
 
-	fdt_for_each_subnode(off, p, node_offset) {
-		int len;
-		const char *name = fdt_get_name(p, off, &len);
-		if (!name)
-			throw std::invalid_argument{fdt_strerror(len)};
-		load(d, off, add_node(n, name));
+/*
+ * load - load FDT from d into root node n
+ *
+ * Nodes are visited in structure block order with a stack of the nodes
+ * which are currently open. Node names are unique to each node, so they are
+ * checked as the nodes are added.
+ */
+void
+load(std::span<const std::byte> d, node &n)
+{
+	const void *p = data(d);
+	std::pmr::vector<node *> open{resource(n)};
+	std::pmr::vector<bool> checked(fdt_size_dt_strings(p), false,
+				       resource(n));
+	int depth{0};
+	int off{0};
+
+	for (; off >= 0 && depth >= 0; off = fdt_next_node(p, off, &depth)) {
+		open.resize(depth);
+		node *cn{&n};
+		if (depth) {
+			int len;
+			const char *name = fdt_get_name(p, off, &len);
+			if (!name)
+				throw std::invalid_argument{fdt_strerror(len)};
+			cn = &add_node(*open.back(), name);
+		}
+		open.push_back(cn);
+		load_properties(d, off, *cn, checked);
 	}
 	if (off < 0 && off != -FDT_ERR_NOTFOUND)
 		throw std::invalid_argument{fdt_strerror(off)};
@@ -178,653 +431,3543 @@ load(std::span<const std::byte> d, const int node_offset, node &n)
 void
 save(const node &n, std::vector<std::byte> &d)
 {
-	fdt_begin_node(name(n), d);
-	for (const auto &cp : properties(n))
-		fdt_property(name(cp), as_bytes(cp), d);
-	for (const auto &cn : subnodes(n))
-		save(cn, d);
-	fdt_end_node(d);
+	size_t open{0};
+	for (const auto &[p, depth] : preorder(n)) {
+		for (; open > depth; --open)
+			fdt_end_node(d);
+		if (is_property(p))
+			fdt_property(name(p), as_bytes(as_property(p)), d);
+		else {
+			fdt_begin_node(name(p), d);
+			++open;
+		}
+	}
+	for (; open; --open)
+		fdt_end_node(d);
 }
 
 /*
- * find_impl - find a piece of the FDT by path
+ * clone - copy node s into d
+ *
+ * Property values are shared if both trees allocate from the same resource
+ * and copied otherwise, so that the copy does not depend on the resource of
+ * the original.
  */
-template<class T>
-std::optional<std::reference_wrapper<
-	std::conditional_t<std::is_const_v<T>, const piece, piece>>>
-find_impl(T &n, std::string_view path)
-{
-	auto sep = path.find('/');
-	auto nn = path.substr(0, sep);
-	if (empty(nn))
-		throw std::invalid_argument{"bad path"};
-	auto c = children(n);
-	auto it = lower_bound(begin(c), end(c), nn, [](auto &l, auto &r) {
-		return name(l) < r;
-	});
-	if (it == end(c))
-		return std::nullopt;
-	/* unit address is optional in node name */
-	if (name(*it) != nn && (!is_node(*it) || node_name(as_node(*it)) != nn))
-		return std::nullopt;
-	/* REVISIT: check for ambiguous path? */
-	if (sep == std::string_view::npos)
-		return std::ref(*it);
-	if (!is_node(*it))
-		return std::nullopt;
-	return find_impl(as_node(*it), path.substr(sep + 1));
+void
+clone(const node &s, node &d)
+{
+	const auto share{resource(d)->is_equal(*resource(s))};
+	std::pmr::vector<node *> open{resource(d)};
+	for (const auto &[p, depth] : preorder(s)) {
+		open.resize(depth);
+		if (!depth)
+			open.push_back(&d);
+		else if (is_property(p)) {
+			auto &np{open.back()->add<property>(name(p),
+							    dtl::trusted)};
+			if (share)
+				set(np, as_property(p));
+			else
+				set(np, as_bytes(as_property(p)));
+		} else
+			open.push_back(&open.back()->add<node>(name(p),
+							      dtl::trusted));
+	}
 }
 
 /*
- * valid_node_char - test if character is allowed in node name or unit address
- *
- * See table 2.1 in the devicetree specification.
+ * path_size - get length of path from root of tree to piece
  */
-bool
-valid_node_char(char c)
+size_t
+path_size(const piece &p)
 {
-	return
-	    (c >= '0' && c <= '9') ||
-	    (c >= 'a' && c <= 'z') ||
-	    (c >= 'A' && c <= 'Z') ||
-	    c == ',' || c == '.' || c == '_' || c == '+' || c == '-';
+	size_t sz{0};
+	for (const piece *i{&p}; parent(*i); i = &parent(*i)->get())
+		sz += size(name(*i)) + 1;
+	return std::max(sz, size_t{1});
 }
 
 /*
- * valid_property_char - test if character is allowed in property name
+ * path_write - write path from root of tree to piece
  *
- * See table 2.2 in the devicetree specification.
+ * The path is written backwards from the end of d which must be exactly
+ * path_size(p) bytes long.
  */
-bool
-valid_property_char(char c)
+void
+path_write(const piece &p, char *d, size_t sz)
 {
-	return
-	    (c >= '0' && c <= '9') ||
-	    (c >= 'a' && c <= 'z') ||
-	    (c >= 'A' && c <= 'Z') ||
-	    c == ',' || c == '.' || c == '_' || c == '+' ||
-	    c == '?' || c == '#' || c == '-';
+	if (!parent(p)) {
+		*d = '/';
+		return;
+	}
+	auto e{d + sz};
+	for (const piece *i{&p}; parent(*i); i = &parent(*i)->get()) {
+		const auto &n{name(*i)};
+		e = std::copy_backward(begin(n), end(n), e);
+		*--e = '/';
+	}
 }
 
 /*
- * load_keep - load a flattened devicetree blob and return loaded bytes
- *
- * Read incoming data from fill function.
+ * find_child - find child of node by exact name
  */
-std::pair<fdt, std::vector<std::byte>>
-load_keep(const std::function<void(size_t, std::vector<std::byte> &)> &fill)
+template<class T>
+auto
+find_child(T &n, std::string_view name)
 {
-	std::vector<std::byte> d;
-	fill(FDT_V1_SIZE, d);
-	fill(fdt_header_size(data(d)), d);
-	if (auto r = fdt_check_header(data(d)); r < 0)
-		throw std::runtime_error{fdt_strerror(r)};
-	fill(fdt_totalsize(data(d)), d);
-
-	return {::fdt::load(d), std::move(d)};
-}
-
+	using P = std::conditional_t<std::is_const_v<T>, const piece, piece>;
+	std::optional<std::reference_wrapper<P>> r;
+	if (const auto p{dtl::named_range<T>::find(n, name)}; p)
+		r = *p;
+	return r;
 }
 
 /*
- * piece
+ * get_phandle - get phandle of node, 0 if node has no phandle
  */
-piece::piece(node &parent, std::string_view name)
-: parent_{std::ref(parent)}
-, name_{name}
-{
-	/* REVISIT: optionally validate names? */
-	if (empty(name_))
-		throw std::invalid_argument{"empty name"};
-}
-
-piece::~piece() = default;
-
-std::string_view
-piece::name() const
+uint32_t
+get_phandle(const node &n)
 {
-	return name_;
+	for (const auto &pn : {"phandle", "linux,phandle"}) {
+		const auto &p{find_child(n, pn)};
+		if (p && is_property(*p) && is<uint32_t>(as_property(*p)))
+			return as<uint32_t>(as_property(*p));
+	}
+	return 0;
 }
 
-std::optional<std::reference_wrapper<node>>
-piece::parent()
+/*
+ * bus_parent, bus_property - access node handle for addressing templates
+ *
+ * A node handle is a const node *, compact_node or frozen_node.
+ */
+std::optional<const node *>
+bus_parent(const node *n)
 {
-	return parent_;
+	const auto &p{parent(*n)};
+	if (!p)
+		return std::nullopt;
+	return &p->get();
 }
 
-std::optional<std::reference_wrapper<const node>>
-piece::parent() const
+std::optional<std::span<const std::byte>>
+bus_property(const node *n, std::string_view name)
 {
-#if __clang__
-	if (parent_)
-		return parent_->get();
-	return {};
-#else
-	return parent_;
-#endif
+	const auto &p{find_child(*n, name)};
+	if (!p || !is_property(*p))
+		return std::nullopt;
+	return as_bytes(as_property(*p));
 }
 
-bool
-operator==(const piece &l, const piece &r)
-{
-	return name(l) == name(r) && l.v_equal(r);
-}
+std::optional<compact_node> bus_parent(compact_node);
+std::optional<std::span<const std::byte>> bus_property(compact_node,
+						       std::string_view);
+std::optional<frozen_node> bus_parent(frozen_node);
+std::optional<std::span<const std::byte>> bus_property(frozen_node,
+						       std::string_view);
 
-std::string_view
-name(const piece &p)
-{
-	return p.name();
-}
+/*
+ * bus_handle - node handle which can be used to decode addresses
+ */
+template<class H>
+concept bus_handle = requires(H h, std::string_view s) {
+	{ bus_parent(h) } -> std::same_as<std::optional<H>>;
+	{ bus_property(h, s) } ->
+	    std::same_as<std::optional<std::span<const std::byte>>>;
+};
 
-std::string
-path(const piece &p)
+/*
+ * get_cells - get cell count property of node
+ */
+template<bus_handle H>
+unsigned
+get_cells(H n, std::string_view name, unsigned def)
 {
-	if (!parent(p))
-		return "/";
-
-	auto t{path(parent(p).value())};
-	if (size(t) > 1)
-		t.append("/");
-	t.append(name(p));
-	return t;
+	const auto &p{bus_property(n, name)};
+	if (!p)
+		return def;
+	if (size(*p) != sizeof(uint32_t))
+		throw std::invalid_argument{"incompatible type"};
+	const auto v{dtl::read<uint32_t>(*p)};
+	if (v > 4)
+		throw std::invalid_argument{"unsupported cell count"};
+	return v;
 }
 
-std::optional<std::reference_wrapper<node>>
-parent(piece &p)
+unsigned
+get_cells(const node &n, std::string_view name, unsigned def)
 {
-	return p.parent();
+	return get_cells(&n, name, def);
 }
 
-std::optional<std::reference_wrapper<const node>> parent(const piece &p)
+/*
+ * read_cells - read value of cells cells from d, truncating to 64 bits
+ */
+uint64_t
+read_cells(std::span<const std::byte> &d, unsigned cells)
 {
-	return p.parent();
+	uint64_t r{0};
+	for (unsigned i{0}; i != cells; ++i)
+		r = r << 32 | dtl::read_advance<uint32_t>(d);
+	return r;
 }
 
-node &
-root(piece &p)
-{
-	if (!parent(p))
-		return as_node(p);
-	return root(parent(p).value());
-}
+/*
+ * bus - decoded addressing properties of a bus node
+ */
+struct bus {
+	struct range {
+		uint64_t child;
+		uint64_t parent;
+		uint64_t size;
+	};
+
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	template<bus_handle H>
+	explicit bus(H, const allocator_type & = {});
+
+	unsigned address_cells;
+	unsigned size_cells;
+	bool translates{false};		/* has ranges property */
+	std::pmr::vector<range> ranges;	/* empty for identity mapping */
+};
+
+template<bus_handle H>
+bus::bus(H n, const allocator_type &a)
+: address_cells{get_cells(n, "#address-cells", 2)}
+, size_cells{get_cells(n, "#size-cells", 1)}
+, ranges{a}
+{
+	const auto &pn{bus_parent(n)};
+	if (!pn)
+		return;
+	const auto &rp{bus_property(n, "ranges")};
+	if (!rp)
+		return;
+	translates = true;
 
-const node &
-root(const piece &p)
-{
-	if (!parent(p))
-		return as_node(p);
-	return root(parent(p).value());
+	auto v{*rp};
+	const auto pac{get_cells(*pn, "#address-cells", 2)};
+	const auto stride{(address_cells + pac + size_cells) * sizeof(uint32_t)};
+	if (empty(v))
+		return;
+	if (!address_cells || !pac || size(v) % stride)
+		throw std::invalid_argument{"bad ranges"};
+	ranges.reserve(size(v) / stride);
+	while (!empty(v)) {
+		const auto c{read_cells(v, address_cells)};
+		const auto p{read_cells(v, pac)};
+		ranges.push_back({c, p, read_cells(v, size_cells)});
+	}
 }
 
-bool
-is_property(const piece &p)
-{
-	return dynamic_cast<const property *>(&p) != nullptr;
-}
+/*
+ * max_interrupt_cells - limit on #interrupt-cells
+ */
+constexpr unsigned max_interrupt_cells{12};
 
-bool
-is_node(const piece &p)
+/*
+ * interrupt_cells - get #interrupt-cells of node
+ */
+unsigned
+interrupt_cells(const node &n)
 {
-	return dynamic_cast<const node *>(&p) != nullptr;
+	const auto &p{find_child(n, "#interrupt-cells")};
+	if (!p || !is_property(*p))
+		throw std::invalid_argument{"no #interrupt-cells"};
+	const auto v{as<uint32_t>(as_property(*p))};
+	if (v > max_interrupt_cells)
+		throw std::invalid_argument{"unsupported cell count"};
+	return v;
 }
 
-property &
-as_property(piece &p)
+/*
+ * hash_cells - FNV-1a hash of cells
+ */
+uint64_t
+hash_cells(std::span<const uint32_t> c)
 {
-	return dynamic_cast<property &>(p);
+	uint64_t h{0xcbf29ce484222325};
+	for (const auto v : c)
+		h = (h ^ v) * 0x100000001b3;
+	return h;
 }
 
-const property &
-as_property(const piece &p)
-{
-	return dynamic_cast<const property &>(p);
-}
+using phandle_map = std::pmr::unordered_map<uint32_t, node *>;
 
-node &
-as_node(piece &p)
-{
-	return dynamic_cast<node &>(p);
+/*
+ * interrupt_map - parsed interrupt-map of an interrupt nexus node
+ */
+struct interrupt_map {
+	struct entry {
+		const node *parent;
+		size_t child;		/* offset of masked child cells */
+		size_t parent_address;	/* offset of parent unit address */
+		unsigned parent_address_cells;
+		unsigned parent_interrupt_cells;
+	};
+
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	interrupt_map(const node &, const phandle_map &,
+		      const allocator_type & = {});
+
+	const entry *find(std::span<const uint32_t> key) const;
+
+	unsigned address_cells;
+	unsigned interrupt_cells;
+	std::pmr::vector<uint32_t> mask;
+	std::pmr::vector<uint32_t> cells;
+	std::pmr::vector<entry> entries;
+	std::pmr::unordered_multimap<uint64_t, size_t> index;
+};
+
+interrupt_map::interrupt_map(const node &n, const phandle_map &ph,
+			     const allocator_type &a)
+: address_cells{get_cells(n, "#address-cells", 2)}
+, interrupt_cells{::fdt::interrupt_cells(n)}
+, mask{a}
+, cells{a}
+, entries{a}
+, index{a}
+{
+	const auto cc{address_cells + interrupt_cells};
+	mask.assign(cc, 0xffffffff);
+	if (const auto &mp{find_child(n, "interrupt-map-mask")};
+	    mp && is_property(*mp)) {
+		auto v{as_bytes(as_property(*mp))};
+		if (size(v) != cc * sizeof(uint32_t))
+			throw std::invalid_argument{"bad interrupt-map-mask"};
+		for (auto &m : mask)
+			m = dtl::read_advance<uint32_t>(v);
+	}
 
+	auto v{as_bytes(get_property(n, "interrupt-map"))};
+	while (!empty(v)) {
+		if (size(v) < (cc + 1) * sizeof(uint32_t))
+			throw std::invalid_argument{"bad interrupt-map"};
+		entry e;
+		e.child = size(cells);
+		for (unsigned i{0}; i != cc; ++i)
+			cells.push_back(dtl::read_advance<uint32_t>(v) & mask[i]);
+		const auto &p{ph.find(dtl::read_advance<uint32_t>(v))};
+		if (p == end(ph))
+			throw std::invalid_argument{"interrupt-map phandle not found"};
+		e.parent = p->second;
+		e.parent_address_cells = get_cells(*e.parent, "#address-cells", 0);
+		e.parent_interrupt_cells = ::fdt::interrupt_cells(*e.parent);
+		e.parent_address = size(cells);
+		const auto pc{e.parent_address_cells + e.parent_interrupt_cells};
+		if (size(v) < pc * sizeof(uint32_t))
+			throw std::invalid_argument{"bad interrupt-map"};
+		for (unsigned i{0}; i != pc; ++i)
+			cells.push_back(dtl::read_advance<uint32_t>(v));
+		index.emplace(hash_cells({data(cells) + e.child, cc}), size(entries));
+		entries.push_back(e);
+	}
 }
 
-const node &
-as_node(const piece &p)
+const interrupt_map::entry *
+interrupt_map::find(std::span<const uint32_t> key) const
 {
-	return dynamic_cast<const node &>(p);
+	/* first matching entry in map order wins */
+	const entry *r{nullptr};
+	const auto [b, e] = index.equal_range(hash_cells(key));
+	for (auto it{b}; it != e; ++it) {
+		const auto &c{entries[it->second]};
+		if (!std::equal(begin(key), end(key), begin(cells) + c.child))
+			continue;
+		if (!r || &c < r)
+			r = &c;
+	}
+	return r;
 }
 
 /*
- * property
+ * for_each_node - call fn for n and all nodes below n
  */
-property::property(node &parent, std::string_view name)
-: piece{parent, name}
+template<class Node, class Fn>
+void
+for_each_node(Node &n, Fn &&fn)
 {
-	/* REVISIT: optionally validate names? */
-	const auto &n = name;
-	if (size(n) > 31)
-		throw std::invalid_argument{"property name too long"};
-	if (std::find_if_not(begin(n), end(n), valid_property_char) != end(n))
-		throw std::invalid_argument{"invalid property name"};
+	for (const auto &[p, depth] : preorder(n))
+		if (is_node(p))
+			fn(as_node(p));
 }
 
-std::span<const std::byte>
-property::get() const
-{
-	return value_;
-}
+/*
+ * overlay - state for applying an overlay to a tree
+ */
+class overlay {
+public:
+	overlay(fdt &base, const fdt &o)
+	: base_{base}
+	, o_{clone(o)}
+	{
+		uint32_t max{0};
+		for_each_node(root(base_), [&](node &n) {
+			if (const auto ph{get_phandle(n)}; ph) {
+				phandles_.emplace(ph, &n);
+				max = std::max(max, ph);
+			}
+		});
+		delta_ = max;
+	}
 
-void
-property::set(container &&v)
-{
-	value_ = std::move(v);
-}
+	void
+	apply()
+	{
+		adjust_phandles();
+		if (const auto &lf{find_child(root(o_), "__local_fixups__")}; lf)
+			local_fixups(as_node(*lf), root(o_));
+		if (const auto &f{find_child(root(o_), "__fixups__")}; f)
+			fixups(as_node(*f));
+		flush();
+		for (auto &frag : subnodes(root(o_))) {
+			const auto &ov{find_child(frag, "__overlay__")};
+			if (!ov || !is_node(*ov))
+				continue;
+			auto &t{target(frag)};
+			targets_.emplace(name(frag), &t);
+			merge(as_node(*ov), t);
+		}
+		if (const auto &s{find_child(root(o_), "__symbols__")}; s)
+			symbols(as_node(*s));
+	}
 
-bool
-property::v_equal(const piece &r) const
+private:
+	/*
+	 * writable - get modifiable copy of property value
+	 *
+	 * Modifications are written back to the property by flush.
+	 */
+	property::container &
+	writable(property &p)
+	{
+		auto [it, inserted] = pending_.try_emplace(&p);
+		if (inserted)
+			it->second.assign(begin(as_bytes(p)), end(as_bytes(p)));
+		return it->second;
+	}
+
+	void
+	flush()
+	{
+		for (auto &[p, v] : pending_)
+			set(*p, std::move(v));
+		pending_.clear();
+	}
+
+	/*
+	 * poke - write phandle into property value at offset
+	 */
+	void
+	poke(property &p, size_t off, uint32_t ph)
+	{
+		auto &v{writable(p)};
+		if (off + sizeof(ph) > size(v))
+			throw std::invalid_argument{"bad overlay fixup offset"};
+		ph = cpu_to_fdt32(ph);
+		std::copy_n(reinterpret_cast<const std::byte *>(&ph), sizeof(ph),
+			    data(v) + off);
+	}
+
+	uint32_t
+	peek(property &p, size_t off)
+	{
+		const auto &v{writable(p)};
+		if (off + sizeof(uint32_t) > size(v))
+			throw std::invalid_argument{"bad overlay fixup offset"};
+		return dtl::read<uint32_t>(std::span{v}.subspan(off));
+	}
+
+	/*
+	 * adjust_phandles - move overlay phandles clear of base phandles
+	 */
+	void
+	adjust_phandles()
+	{
+		for_each_node(root(o_), [&](node &n) {
+			for (const auto &pn : {"phandle", "linux,phandle"}) {
+				const auto &p{find_child(n, pn)};
+				if (!p || !is_property(*p))
+					continue;
+				auto &pp{as_property(*p)};
+				const auto ph{as<uint32_t>(pp)};
+				if (!ph || ph == 0xffffffff)
+					continue;
+				if (ph > 0xfffffffe - delta_)
+					throw std::invalid_argument{"overlay phandle overflow"};
+				set(pp, ph + delta_);
+			}
+		});
+	}
+
+	/*
+	 * local_fixups - adjust overlay references to overlay phandles
+	 *
+	 * __local_fixups__ mirrors the overlay structure. Each property lists
+	 * offsets of phandles in the property of the same name.
+	 */
+	void
+	local_fixups(const node &lf, node &n)
+	{
+		for (const auto &lp : properties(lf)) {
+			const auto &p{find_child(n, name(lp))};
+			if (!p || !is_property(*p))
+				throw std::invalid_argument{"bad overlay local fixup"};
+			for (const auto off : as_array<uint32_t>(lp))
+				poke(as_property(*p), off,
+				     peek(as_property(*p), off) + delta_);
+		}
+		for (const auto &ln : subnodes(lf)) {
+			const auto &cn{find_child(n, name(ln))};
+			if (!cn || !is_node(*cn))
+				throw std::invalid_argument{"bad overlay local fixup"};
+			local_fixups(ln, as_node(*cn));
+		}
+	}
+
+	/*
+	 * fixups - resolve overlay references to labels in base tree
+	 *
+	 * Each property in __fixups__ is named after a label and lists
+	 * references to it as "path:property:offset". Labels are resolved
+	 * through the label index of the base tree.
+	 */
+	void
+	fixups(const node &f)
+	{
+		for (const auto &fp : properties(f)) {
+			const auto &sn{find_label(base_, name(fp))};
+			if (!sn)
+				throw std::invalid_argument{"overlay label not found"};
+			const auto ph{get_phandle(sn->get())};
+			if (!ph)
+				throw std::invalid_argument{"overlay label has no phandle"};
+			for (const auto &r : as_stringlist(fp)) {
+				const auto c1{r.find(':')};
+				const auto c2{r.find(':', c1 + 1)};
+				if (c1 == std::string_view::npos ||
+				    c2 == std::string_view::npos)
+					throw std::invalid_argument{"bad overlay fixup"};
+				const auto os{r.substr(c2 + 1)};
+				size_t off;
+				if (auto [e, ec] = std::from_chars(data(os),
+					data(os) + size(os), off);
+				    ec != std::errc{} || e != data(os) + size(os))
+					throw std::invalid_argument{"bad overlay fixup"};
+				auto &n{get_node(o_, r.substr(0, c1))};
+				poke(get_property(n, r.substr(c1 + 1, c2 - c1 - 1)),
+				     off, ph);
+			}
+		}
+	}
+
+	/*
+	 * target - find base tree node targeted by fragment
+	 */
+	node &
+	target(const node &frag)
+	{
+		if (const auto &t{find_child(frag, "target")}; t) {
+			const auto &it{phandles_.find(as<uint32_t>(as_property(*t)))};
+			if (it == end(phandles_))
+				throw std::invalid_argument{"overlay target not found"};
+			return *it->second;
+		}
+		if (const auto &t{find_child(frag, "target-path")}; t) {
+			const auto &tn{find(base_, as_string(as_property(*t)))};
+			if (!tn || !is_node(*tn))
+				throw std::invalid_argument{"overlay target not found"};
+			return as_node(*tn);
+		}
+		throw std::invalid_argument{"overlay fragment has no target"};
+	}
+
+	/*
+	 * merge - merge overlay node s into base tree node d
+	 */
+	void
+	merge(const node &s, node &d)
+	{
+		std::vector<node *> open, merged;
+		for (const auto &[p, depth] : preorder(s)) {
+			open.resize(depth);
+			if (!depth) {
+				open.push_back(&d);
+				merged.push_back(&d);
+				continue;
+			}
+			auto &dn{*open.back()};
+			const auto &dp{find_child(dn, name(p))};
+			if (is_property(p)) {
+				if (dp && !is_property(*dp))
+					throw std::invalid_argument{"overlay property clashes with node"};
+				set(dp ? as_property(*dp) : add_property(dn, name(p)),
+				    as_property(p));
+			} else {
+				if (dp && !is_node(*dp))
+					throw std::invalid_argument{"overlay node clashes with property"};
+				open.push_back(dp ? &as_node(*dp) : &add_node(dn, name(p)));
+				merged.push_back(open.back());
+			}
+		}
+		for (const auto n : merged)
+			if (const auto ph{get_phandle(*n)}; ph)
+				phandles_.emplace(ph, n);
+	}
+
+	/*
+	 * symbols - add overlay labels to base tree __symbols__
+	 *
+	 * Labels inside fragments are rewritten to point at the merged nodes.
+	 * Other labels only make sense within the overlay and are skipped.
+	 */
+	void
+	symbols(const node &s)
+	{
+		const auto &bs{find_child(root(base_), "__symbols__")};
+		auto &bsn{bs ? as_node(*bs) : add_node(root(base_), "__symbols__")};
+		for (const auto &sp : properties(s)) {
+			const auto &p{as_string(sp)};
+			if (!p.starts_with('/'))
+				continue;
+			const auto fe{p.find('/', 1)};
+			const auto &it{targets_.find(p.substr(1, fe - 1))};
+			if (fe == std::string_view::npos || it == end(targets_))
+				continue;
+			auto rest{p.substr(fe + 1)};
+			if (!rest.starts_with("__overlay__"))
+				continue;
+			rest.remove_prefix(size(std::string_view{"__overlay__"}));
+			if (!empty(rest) && !rest.starts_with('/'))
+				continue;
+			auto t{path(*it->second)};
+			if (size(t) == 1 && !empty(rest))
+				t.clear();
+			t.append(rest);
+			const auto &bp{find_child(bsn, name(sp))};
+			set(bp ? as_property(*bp) : add_property(bsn, name(sp)),
+			    std::string_view{t});
+		}
+	}
+
+	fdt &base_;
+	fdt o_;
+	uint32_t delta_;
+	std::unordered_map<uint32_t, node *> phandles_;
+	std::unordered_map<std::string_view, node *> targets_;
+	std::unordered_map<property *, property::container> pending_;
+};
+
+/*
+ * find_step - find child of node by path component
+ */
+template<class T>
+result<std::reference_wrapper<
+	std::conditional_t<std::is_const_v<T>, const piece, piece>>>
+find_step(T &n, std::string_view nn)
+{
+	if (empty(nn))
+		return dtl::fail(errc::bad_path);
+	auto *p{dtl::named_range<T>::find(n, nn)};
+	if (!p) {
+		/* unit address is optional in node name if unambiguous */
+		const dtl::named_range<T> r{n, nn};
+		auto it{r.begin()};
+		if (it == r.end())
+			return dtl::fail(errc::not_found);
+		p = &*it;
+		if (++it != r.end())
+			return dtl::fail(errc::ambiguous_path);
+	}
+	return std::ref(*p);
+}
+
+/*
+ * find_impl - find a piece of the FDT by path
+ */
+template<class T>
+result<std::reference_wrapper<
+	std::conditional_t<std::is_const_v<T>, const piece, piece>>>
+find_impl(T &n, std::string_view path)
+{
+	auto sep = path.find('/');
+	const auto &r{find_step(n, path.substr(0, sep))};
+	if (!r || sep == std::string_view::npos)
+		return r;
+	if (!is_node(r->get()))
+		return dtl::fail(errc::not_found);
+	return find_impl(as_node(r->get()), path.substr(sep + 1));
+}
+
+/*
+ * to_optional - convert find result to optional, throwing if path is invalid
+ */
+template<class T>
+std::optional<T>
+to_optional(const result<T> &r)
+{
+	if (r)
+		return *r;
+	if (r.error() == errc::bad_path)
+		throw std::invalid_argument{"bad path"};
+	if (r.error() == errc::ambiguous_path)
+		throw std::invalid_argument{"ambiguous path"};
+	return std::nullopt;
+}
+
+/*
+ * to_node - convert find result to node
+ */
+template<class P, class N = std::conditional_t<std::is_const_v<P>,
+					       const node, node>>
+result<std::reference_wrapper<N>>
+to_node(const result<std::reference_wrapper<P>> &r)
+{
+	if (!r)
+		return dtl::fail(r.error());
+	auto n{dynamic_cast<N *>(&r->get())};
+	if (!n)
+		return dtl::fail(errc::not_node);
+	return std::ref(*n);
+}
+
+/*
+ * to_property - convert find result to property
+ */
+template<class P, class N = std::conditional_t<std::is_const_v<P>,
+					       const property, property>>
+result<std::reference_wrapper<N>>
+to_property(const result<std::reference_wrapper<P>> &r)
+{
+	if (!r)
+		return dtl::fail(r.error());
+	auto n{dynamic_cast<N *>(&r->get())};
+	if (!n)
+		return dtl::fail(errc::not_property);
+	return std::ref(*n);
+}
+
+/*
+ * valid_node_char - test if character is allowed in node name or unit address
+ */
+bool
+valid_node_char(char c)
+{
+	return dtl::name_chars[static_cast<unsigned char>(c)] & dtl::node_char;
+}
+
+/*
+ * read_blob - read a flattened devicetree blob into container d
+ *
+ * Read incoming data from fill function.
+ */
+template<class C, class F>
+void
+read_blob(C &d, const F &fill)
+{
+	fill(FDT_V1_SIZE, d);
+	fill(fdt_header_size(data(d)), d);
+	if (auto r = fdt_check_header(data(d)); r < 0)
+		throw std::runtime_error{fdt_strerror(r)};
+	fill(fdt_totalsize(data(d)), d);
+}
+
+/*
+ * fd_fill - fill function reading from file descriptor
+ */
+auto
+fd_fill(const int fd)
+{
+	return [fd](size_t len, auto &d) {
+		auto off{d.size()};
+		d.resize(len);
+		while (off != len) {
+			const auto rd{read(fd, data(d) + off, len - off)};
+			if (rd < 0)
+				throw std::runtime_error{strerror(errno)};
+			if (rd == 0)
+				throw std::runtime_error{fdt_strerror(FDT_ERR_TRUNCATED)};
+			off += rd;
+		}
+	};
+}
+
+/*
+ * stream_fill - fill function reading from stream
+ */
+auto
+stream_fill(std::istream &f)
+{
+	return [&f](size_t len, auto &d) {
+		const auto prev{d.size()};
+		d.resize(len);
+		f.read(reinterpret_cast<char *>(data(d)) + prev, len - prev);
+		if (static_cast<size_t>(f.gcount()) != len - prev)
+			throw std::runtime_error{fdt_strerror(FDT_ERR_TRUNCATED)};
+	};
+}
+
+}
+
+/*
+ * dtl::tree - state shared by all pieces of a tree
+ */
+struct dtl::tree {
+	explicit tree(std::pmr::memory_resource *);
+
+	static tree *of(const piece &);
+
+	node *alias(std::string_view);
+	node *label(std::string_view);
+	const ::fdt::bus &bus(const node &);
+	node *phandle(uint32_t);
+	const ::fdt::interrupt_map *interrupt_map(const node &);
+
+	std::pmr::memory_resource *const resource;
+	node root;
+
+	/* generation changes whenever the tree is modified */
+	uint64_t generation;
+
+private:
+	void index();
+	void index_phandles();
+	void flush();
+
+	/* caches are rebuilt on first use after a modification */
+	std::mutex lock_;
+	uint64_t index_generation_{0};
+	std::pmr::unordered_map<std::string_view, node *> aliases_;
+	std::pmr::unordered_map<std::string_view, node *> labels_;
+	uint64_t phandle_generation_{0};
+	phandle_map phandles_;
+	uint64_t cache_generation_{0};
+	std::pmr::unordered_map<const node *, ::fdt::bus> buses_;
+	std::pmr::unordered_map<const node *, ::fdt::interrupt_map>
+	    interrupt_maps_;
+};
+
+dtl::tree::tree(std::pmr::memory_resource *r)
+: resource{r}
+, root{*this}
+, generation{next_generation()}
+, aliases_{r}
+, labels_{r}
+, phandles_{r}
+, buses_{r}
+, interrupt_maps_{r}
+{ }
+
+dtl::tree *
+dtl::tree::of(const piece &p)
+{
+	return p.tree_;
+}
+
+void
+dtl::tree_delete::operator()(tree *t) const
+{
+	std::pmr::polymorphic_allocator<>{t->resource}.delete_object(t);
+}
+
+node *
+dtl::tree::alias(std::string_view n)
+{
+	std::lock_guard l{lock_};
+	index();
+	const auto &it{aliases_.find(n)};
+	return it == end(aliases_) ? nullptr : it->second;
+}
+
+node *
+dtl::tree::label(std::string_view n)
+{
+	std::lock_guard l{lock_};
+	index();
+	const auto &it{labels_.find(n)};
+	return it == end(labels_) ? nullptr : it->second;
+}
+
+/*
+ * bus - get decoded addressing properties of bus node
+ *
+ * Elements of an unordered_map are not moved by insertion so the returned
+ * reference remains valid until the tree is modified.
+ */
+const ::fdt::bus &
+dtl::tree::bus(const node &n)
+{
+	std::lock_guard l{lock_};
+	flush();
+	if (const auto &it{buses_.find(&n)}; it != end(buses_))
+		return it->second;
+	return buses_.try_emplace(&n, &n).first->second;
+}
+
+node *
+dtl::tree::phandle(uint32_t ph)
+{
+	std::lock_guard l{lock_};
+	index_phandles();
+	const auto &it{phandles_.find(ph)};
+	return it == end(phandles_) ? nullptr : it->second;
+}
+
+/*
+ * interrupt_map - get parsed interrupt-map of node, nullptr if none
+ */
+const ::fdt::interrupt_map *
+dtl::tree::interrupt_map(const node &n)
+{
+	std::lock_guard l{lock_};
+	flush();
+	if (const auto &it{interrupt_maps_.find(&n)}; it != end(interrupt_maps_))
+		return &it->second;
+	const auto &mp{find_child(n, "interrupt-map")};
+	if (!mp || !is_property(*mp))
+		return nullptr;
+	index_phandles();
+	return &interrupt_maps_.try_emplace(&n, n, phandles_).first->second;
+}
+
+/*
+ * index_phandles - index nodes by phandle
+ */
+void
+dtl::tree::index_phandles()
+{
+	if (phandle_generation_ == generation)
+		return;
+	phandles_.clear();
+	for_each_node(root, [this](node &n) {
+		if (const auto ph{get_phandle(n)}; ph)
+			phandles_.emplace(ph, &n);
+	});
+	phandle_generation_ = generation;
+}
+
+/*
+ * flush - drop per node caches if the tree has been modified
+ */
+void
+dtl::tree::flush()
+{
+	if (cache_generation_ == generation)
+		return;
+	buses_.clear();
+	interrupt_maps_.clear();
+	cache_generation_ = generation;
+}
+
+/*
+ * index - index /aliases and /__symbols__ by name
+ */
+void
+dtl::tree::index()
+{
+	if (index_generation_ == generation)
+		return;
+
+	auto add = [this](std::string_view in, auto &m) {
+		m.clear();
+		const auto &i{find_child(root, in)};
+		if (!i || !is_node(*i))
+			return;
+		for (const auto &p : properties(as_node(*i))) {
+			if (!is_string(p) || !as_string(p).starts_with('/'))
+				continue;
+			const auto &v{as_string(p).substr(1)};
+			if (empty(v)) {
+				m.emplace(name(p), &root);
+				continue;
+			}
+			if (const auto &t{to_node(find_impl(root, v))}; t)
+				m.emplace(name(p), &t->get());
+		}
+	};
+
+	add("aliases", aliases_);
+	add("__symbols__", labels_);
+	index_generation_ = generation;
+}
+
+namespace {
+
+/*
+ * find_fdt - find a piece of the FDT by absolute, alias or label path
+ *
+ * An alias or label which does not exist is not_found.
+ */
+template<class F,
+	 class N = std::conditional_t<std::is_const_v<F>, const node, node>,
+	 class P = std::conditional_t<std::is_const_v<F>, const piece, piece>>
+result<std::reference_wrapper<P>>
+find_fdt(F &f, std::string_view path)
+{
+	if (path.starts_with('/'))
+		return find_impl(root(f), path.substr(1));
+	auto &t{*dtl::tree::of(root(f))};
+	const auto sep{path.find('/')};
+	const auto &an{path.substr(0, sep)};
+	if (empty(an) || an == "&")
+		return dtl::fail(errc::bad_path);
+	N *n{an.starts_with('&') ? t.label(an.substr(1)) : t.alias(an)};
+	if (!n)
+		return dtl::fail(errc::not_found);
+	if (sep == std::string_view::npos)
+		return std::reference_wrapper<P>{*n};
+	return find_impl(*n, path.substr(sep + 1));
+}
+
+/*
+ * try_find_fdt - find_fdt reporting a failed index rebuild as no_index
+ */
+template<class F,
+	 class P = std::conditional_t<std::is_const_v<F>, const piece, piece>>
+result<std::reference_wrapper<P>>
+try_find_fdt(F &f, std::string_view path) noexcept
+{
+	try {
+		return find_fdt(f, path);
+	} catch (const std::bad_alloc &) {
+		return dtl::fail(errc::no_index);
+	} catch (const std::system_error &) {
+		return dtl::fail(errc::no_index);
+	}
+}
+
+/*
+ * find_components - find a piece of the FDT by split path
+ *
+ * For fdt lookups a relative path starts with an alias or label.
+ */
+template<class T, class R,
+	 class P = std::conditional_t<std::is_const_v<T>, const piece, piece>>
+result<std::reference_wrapper<P>>
+find_components(T &start, bool fdt, bool absolute, const R &components)
+{
+	auto it{begin(components)};
+	T *n{&start};
+	if (fdt && !absolute) {
+		auto &t{*dtl::tree::of(start)};
+		const std::string_view an{*it++};
+		n = an.starts_with('&') ? t.label(an.substr(1)) : t.alias(an);
+		if (!n)
+			return dtl::fail(errc::not_found);
+	} else if (!fdt && absolute)
+		return dtl::fail(errc::bad_path);
+	P *p{n};
+	for (; it != end(components); ++it) {
+		if (!is_node(*p))
+			return dtl::fail(errc::not_found);
+		const auto &r{find_step(as_node(*p), *it)};
+		if (!r)
+			return dtl::fail(r.error());
+		p = &r->get();
+	}
+	return std::ref(*p);
+}
+
+}
+
+/*
+ * piece
+ */
+piece::piece(dtl::tree &t)
+: tree_{&t}
+{ }
+
+piece::piece(node &parent, std::string_view name)
+: tree_{parent.tree_}
+, parent_{&parent}
+, name_{name, resource(parent)}
+{
+	/* REVISIT: optionally validate names? */
+	if (empty(name_))
+		throw std::invalid_argument{"empty name"};
+}
+
+piece::~piece() = default;
+
+void
+dtl::piece_delete::operator()(piece *p) const
+{
+	std::destroy_at(p);
+	resource->deallocate(p, size, alignof(std::max_align_t));
+}
+
+std::string_view
+piece::name() const
+{
+	return name_;
+}
+
+void
+piece::modified()
+{
+	if (tree_)
+		tree_->generation = next_generation();
+}
+
+std::optional<std::reference_wrapper<node>>
+piece::parent()
+{
+	if (!parent_)
+		return std::nullopt;
+	return *parent_;
+}
+
+std::optional<std::reference_wrapper<const node>>
+piece::parent() const
+{
+	if (!parent_)
+		return std::nullopt;
+	return *parent_;
+}
+
+bool
+operator==(const piece &l, const piece &r)
+{
+	return name(l) == name(r) && l.v_equal(r);
+}
+
+std::string_view
+name(const piece &p)
+{
+	return p.name();
+}
+
+std::string
+path(const piece &p)
+{
+	std::string t;
+	path(p, t);
+	return t;
+}
+
+void
+path(const piece &p, std::string &s)
+{
+	s.resize(path_size(p));
+	path_write(p, data(s), size(s));
+}
+
+size_t
+path(const piece &p, std::span<char> b)
+{
+	const auto sz{path_size(p)};
+	if (sz <= size(b))
+		path_write(p, data(b), sz);
+	return sz;
+}
+
+std::optional<std::reference_wrapper<node>>
+parent(piece &p)
+{
+	return p.parent();
+}
+
+std::optional<std::reference_wrapper<const node>> parent(const piece &p)
+{
+	return p.parent();
+}
+
+node &
+root(piece &p)
+{
+	if (const auto &t{dtl::tree::of(p)}; t)
+		return t->root;
+	/* tree not owned by an fdt */
+	if (!parent(p))
+		return as_node(p);
+	return root(parent(p).value());
+}
+
+const node &
+root(const piece &p)
+{
+	if (const auto &t{dtl::tree::of(p)}; t)
+		return t->root;
+	/* tree not owned by an fdt */
+	if (!parent(p))
+		return as_node(p);
+	return root(parent(p).value());
+}
+
+bool
+is_property(const piece &p)
+{
+	return dynamic_cast<const property *>(&p) != nullptr;
+}
+
+bool
+is_node(const piece &p)
+{
+	return dynamic_cast<const node *>(&p) != nullptr;
+}
+
+property &
+as_property(piece &p)
+{
+	return dynamic_cast<property &>(p);
+}
+
+const property &
+as_property(const piece &p)
+{
+	return dynamic_cast<const property &>(p);
+}
+
+node &
+as_node(piece &p)
+{
+	return dynamic_cast<node &>(p);
+
+}
+
+const node &
+as_node(const piece &p)
+{
+	return dynamic_cast<const node &>(p);
+}
+
+/*
+ * property
+ */
+property::property(node &parent, std::string_view name)
+: piece{parent, name}
+{
+	/* REVISIT: optionally validate names? */
+	check_property_name(name);
+}
+
+property::property(node &parent, std::string_view name, dtl::trusted_t)
+: piece{parent, name}
+{ }
+
+std::span<const std::byte>
+property::get() const
+{
+	return {value_.get(), size_};
+}
+
+void
+property::set(container &&v)
+{
+	/* adopt the container storage unless the tree has its own resource */
+	if (empty(v) || !resource(parent()->get())->is_equal(
+	    *std::pmr::new_delete_resource())) {
+		set(std::span<const std::byte>{v});
+		return;
+	}
+	const auto &c{std::make_shared<const container>(std::move(v))};
+	value_ = std::shared_ptr<const std::byte[]>{c, data(*c)};
+	size_ = size(*c);
+	kind_.store(0, std::memory_order_relaxed);
+	modified();
+}
+
+bool
+property::v_equal(const piece &r) const
+{
+	if (!is_property(r))
+		return false;
+	const auto &lv{get()};
+	const auto &rv{as_property(r).get()};
+	return std::equal(begin(lv), end(lv), begin(rv), end(rv));
+}
+
+void
+property::set(std::span<const std::byte> v)
+{
+	/* allocate before releasing old value in case v refers to it */
+	auto t{alloc_value(size(v), resource(parent()->get()))};
+	std::copy(begin(v), end(v), t.get());
+	value_ = std::move(t);
+	size_ = size(v);
+	kind_.store(0, std::memory_order_relaxed);
+	modified();
+}
+
+void
+property::set(const property &p)
+{
+	value_ = p.value_;
+	size_ = p.size_;
+	kind_.store(p.kind_.load(std::memory_order_relaxed),
+		    std::memory_order_relaxed);
+	modified();
+}
+
+std::span<std::byte>
+property::allocate(size_t sz)
+{
+	auto t{alloc_value(sz, resource(parent()->get()))};
+	std::span<std::byte> r{t.get(), sz};
+	value_ = std::move(t);
+	size_ = sz;
+	kind_.store(0, std::memory_order_relaxed);
+	modified();
+	return r;
+}
+
+uint8_t
+property::classify() const
+{
+	auto k{kind_.load(std::memory_order_relaxed)};
+	if (!k) {
+		k = classify_value(get());
+		kind_.store(k, std::memory_order_relaxed);
+	}
+	return k;
+}
+
+/*
+ * stringlist
+ */
+stringlist::stringlist(std::span<const std::byte> d, empty e)
+: d_{d}
+, empty_{e}
+{ }
+
+stringlist::iterator
+stringlist::begin() const
+{
+	const auto p{reinterpret_cast<const char *>(data(d_))};
+	return {p, p + size(d_), empty_ == empty::keep};
+}
+
+stringlist::iterator
+stringlist::end() const
+{
+	const auto e{reinterpret_cast<const char *>(data(d_)) + size(d_)};
+	return {e, e, empty_ == empty::keep};
+}
+
+stringlist::iterator::iterator(const char *p, const char *e, bool keep)
+: p_{p}
+, e_{e}
+, keep_{keep}
+{
+	settle();
+}
+
+stringlist::iterator &
+stringlist::iterator::operator++()
+{
+	p_ += std::min<size_t>(n_ + 1, e_ - p_);
+	settle();
+	return *this;
+}
+
+void
+stringlist::iterator::settle()
+{
+	/* skip empty strings and find length of next string */
+	while (!keep_ && p_ != e_ && !*p_)
+		++p_;
+	const auto z{static_cast<const char *>(memchr(p_, 0, e_ - p_))};
+	n_ = (z ? z : e_) - p_;
+}
+
+namespace {
+
+/*
+ * set_strings - set property to null terminated strings
+ *
+ * The strings are written straight into storage allocated from the resource
+ * of the property. Empty strings are skipped and missing terminators added.
+ */
+void
+set_strings(property &p, std::span<const std::string_view> v)
+{
+	size_t sz{0};
+	bool alias{false};
+	const auto o{as_bytes(p)};
+	for (const auto &s : v) {
+		if (empty(s))
+			continue;
+		sz += size(s) + (s.back() != 0);
+		const auto b{reinterpret_cast<const std::byte *>(data(s))};
+		alias |= !empty(o) && std::less_equal{}(data(o), b) &&
+			 std::less{}(b, data(o) + size(o));
+	}
+
+	/* allocate releases the old value, so copy strings which refer to it
+	 * through a temporary */
+	std::pmr::vector<std::byte> t{resource(parent(p)->get())};
+	if (alias)
+		t.resize(sz);
+	auto w{alias ? data(t) : data(p.allocate(sz))};
+	for (const auto &s : v) {
+		if (empty(s))
+			continue;
+		w = std::copy_n(reinterpret_cast<const std::byte *>(data(s)),
+				size(s), w);
+		if (s.back() != 0)
+			*w++ = 0_byte;
+	}
+	if (alias)
+		p.set(t);
+}
+
+}
+
+void
+set(property &p, uint32_t v)
+{
+	v = cpu_to_fdt32(v);
+	set(p, {reinterpret_cast<std::byte *>(&v), sizeof(v)});
+}
+
+void
+set(property &p, uint64_t v)
+{
+	v = cpu_to_fdt64(v);
+	set(p, {reinterpret_cast<std::byte *>(&v), sizeof(v)});
+}
+
+void
+set(property &p, std::string_view v)
+{
+	/* string is empty or null teriminated, ok to assign */
+	if (empty(v) || v.back() == 0) {
+		set(p, {data(v), size(v)});
+		return;
+	}
+
+	/* string is not null terminated, append terminator */
+	set_strings(p, std::span{&v, 1});
+}
+
+void
+set(property &p, const std::vector<std::string_view> &v)
+{
+	set_strings(p, v);
+}
+
+void
+set(property &p, property::container &&v)
+{
+	p.set(std::move(v));
+}
+
+void
+set(property &p, std::span<const std::byte> v)
+{
+	p.set(v);
+}
+
+void
+set(property &p, const property &v)
+{
+	p.set(v);
+}
+
+bool
+is_empty(const property &p)
+{
+	return empty(as_bytes(p));
+}
+
+bool
+is_string(const property &p)
+{
+	return p.classify() & kind_string;
+}
+
+bool
+is_stringlist(const property &p)
+{
+	return p.classify() & kind_stringlist;
+}
+
+/*
+ * as_*
+ */
+std::string_view
+as_string(const property &p)
+{
+	const auto &s{try_as_string(p)};
+	if (!s)
+		throw std::invalid_argument{"not a string"};
+	return *s;
+}
+
+stringlist
+as_stringlist(const property &p, stringlist::empty e)
+{
+	if (!is_stringlist(p))
+		throw std::invalid_argument{"not a stringlist"};
+	return stringlist{as_bytes(p), e};
+}
+
+std::span<const std::byte>
+as_bytes(const property &p)
+{
+	return p.get();
+}
+
+/*
+ * stringlist_*
+ */
+namespace {
+
+/*
+ * stringlist_walk - call fn with each string of a stringlist and its index
+ *
+ * Empty strings are counted as by libfdt's fdt_stringlist_* so indices
+ * match companion properties such as clocks and clock-names. Stops when fn
+ * returns true and returns the index reached.
+ */
+template<class Fn>
+size_t
+stringlist_walk(const property &p, Fn &&fn)
+{
+	/* as_stringlist checks the cached classification without rescanning */
+	size_t i{0};
+	for (const auto s : as_stringlist(p, stringlist::empty::keep)) {
+		if (fn(s, i))
+			break;
+		++i;
+	}
+	return i;
+}
+
+}
+
+size_t
+stringlist_count(const property &p)
+{
+	return stringlist_walk(p, [](std::string_view, size_t) {
+		return false;
+	});
+}
+
+std::optional<size_t>
+stringlist_index(const property &p, std::string_view s)
+{
+	bool found{false};
+	const auto i{stringlist_walk(p, [&](std::string_view v, size_t) {
+		return found = v == s;
+	})};
+	if (!found)
+		return std::nullopt;
+	return i;
+}
+
+std::string_view
+stringlist_at(const property &p, size_t i)
+{
+	std::optional<std::string_view> r;
+	stringlist_walk(p, [&](std::string_view v, size_t n) {
+		if (n != i)
+			return false;
+		r = v;
+		return true;
+	});
+	if (!r)
+		throw std::out_of_range{"stringlist index out of range"};
+	return *r;
+}
+
+result<std::string_view>
+try_as_string(const property &p)
+{
+	if (!is_string(p))
+		return dtl::fail(errc::incompatible_type);
+	const auto &v = as_bytes(p);
+	return std::string_view{reinterpret_cast<const char *>(data(v)),
+				size(v) - 1};
+}
+
+/*
+ * node
+ */
+bool
+node::set_compare::operator()(const piece_p &l, const piece_p &r) const
+{
+	return l->name() < r->name();
+}
+
+node::node(dtl::tree &t)
+: piece{t}
+, children_{t.resource}
+{ }
+
+node::node(node &parent, std::string_view name)
+: piece{parent, name}
+, children_{parent.children_.get_allocator()}
+{
+	/* REVISIT: optionally validate names? */
+	const auto &nn{node_name(*this)};
+	const auto &ua{unit_address(*this)};
+	if (size(nn) > 31)
+		throw std::invalid_argument{"node name too long"};
+	if (empty(nn) ||
+	    std::find_if_not(begin(nn), end(nn), valid_node_char) != end(nn))
+		throw std::invalid_argument{"invalid node name"};
+	if (ua.has_value() && (ua->empty() ||
+	    std::find_if_not(begin(*ua), end(*ua), valid_node_char) != end(*ua)))
+		throw std::invalid_argument{"invalid unit address"};
+}
+
+node::node(node &parent, std::string_view name, dtl::trusted_t)
+: piece{parent, name}
+, children_{parent.children_.get_allocator()}
+{ }
+
+node::~node()
+{
+	/* destroy subtree without recursion so deep trees can not overflow
+	 * the stack */
+	std::pmr::vector<piece_p> doomed{children_.get_allocator()};
+	auto take = [&](node &n) {
+		while (!n.children_.empty())
+			doomed.push_back(std::move(
+				n.children_.extract(n.children_.begin()).value()));
+	};
+	take(*this);
+	while (!doomed.empty()) {
+		const auto p{std::move(doomed.back())};
+		doomed.pop_back();
+		if (is_node(*p))
+			take(as_node(*p));
+	}
+}
+
+bool
+node::v_equal(const piece &r) const
+{
+	if (!is_node(r))
+		return false;
+	/* compare pieces below both nodes in lockstep */
+	const auto &lw{preorder(*this)};
+	const auto &rw{preorder(as_node(r))};
+	auto li{lw.begin()}, ri{rw.begin()};
+	for (++li, ++ri; li != lw.end() && ri != rw.end(); ++li, ++ri) {
+		const auto &[lp, ld] = *li;
+		const auto &[rp, rd] = *ri;
+		if (ld != rd || is_node(lp) != is_node(rp))
+			return false;
+		if (is_node(lp) ? lp.name() != rp.name() : !(lp == rp))
+			return false;
+	}
+	return li == lw.end() && ri == rw.end();
+}
+
+std::pmr::memory_resource *
+resource(const node &n)
+{
+	return n.children_.get_allocator().resource();
+}
+
+node &
+add_node(node &n, std::string_view name)
+{
+	return n.add<node>(name);
+}
+
+property &
+add_property(node &n, std::string_view name)
+{
+	return n.add<property>(name);
+}
+
+std::string_view
+node_name(const node &n)
+{
+	const auto &nn = name(n);
+	return nn.substr(0, nn.find('@'));
+}
+
+std::optional<std::string_view>
+unit_address(const node &n)
+{
+	const auto &nn = name(n);
+	auto at = nn.find('@');
+	if (at == std::string_view::npos)
+		return std::nullopt;
+	return nn.substr(at + 1);
+}
+
+namespace {
+
+/*
+ * with_bus - call fn with decoded addressing properties of bus node
+ *
+ * Nodes which belong to an fdt use the cache of the tree. Other nodes are
+ * decoded on every call, with their ranges held on the stack if they fit.
+ */
+template<bus_handle H, class Fn>
+auto
+with_bus(H n, Fn &&fn)
+{
+	if constexpr (std::is_same_v<H, const node *>) {
+		if (const auto &t{dtl::tree::of(*n)}; t)
+			return fn(t->bus(*n));
+	}
+	std::array<std::byte, 256> b;
+	std::pmr::monotonic_buffer_resource r{data(b), size(b)};
+	return fn(bus{n, &r});
+}
+
+/*
+ * translate - translate address on bus n into root address space
+ */
+template<bus_handle H>
+uint64_t
+translate(H n, uint64_t a)
+{
+	for (std::optional<H> pn; (pn = bus_parent(n)); n = *pn) {
+		a = with_bus(n, [a](const bus &b) {
+			if (!b.translates)
+				throw std::invalid_argument{"address not translatable"};
+			if (empty(b.ranges))
+				return a;
+			for (const auto &r : b.ranges)
+				if (a >= r.child && a - r.child < r.size)
+					return a - r.child + r.parent;
+			throw std::invalid_argument{"address not translatable"};
+		});
+	}
+	return a;
+}
+
+/*
+ * decode_reg - decode reg of n into root address space regions
+ *
+ * Returns the number of regions, decoding nothing if o is too small.
+ */
+template<bus_handle H>
+size_t
+decode_reg(H n, std::span<region> o)
+{
+	const auto &pn{bus_parent(n)};
+	if (!pn)
+		throw std::invalid_argument{"root node has no reg"};
+	const auto &rp{bus_property(n, "reg")};
+	if (!rp)
+		throw std::invalid_argument{"no reg property"};
+	auto v{*rp};
+	const auto [ac, sc] = with_bus(*pn, [](const bus &b) {
+		return std::pair{b.address_cells, b.size_cells};
+	});
+	const auto stride{(ac + sc) * sizeof(uint32_t)};
+	if (!ac || size(v) % stride)
+		throw std::invalid_argument{"bad reg"};
+	const auto count{size(v) / stride};
+	if (count > size(o))
+		return count;
+	for (auto &r : o.first(count)) {
+		const auto a{read_cells(v, ac)};
+		r = {translate(*pn, a), read_cells(v, sc)};
+	}
+	return count;
+}
+
+template<bus_handle H>
+std::vector<region>
+decode_reg(H n)
+{
+	std::vector<region> r(decode_reg(n, {}));
+	decode_reg(n, r);
+	return r;
+}
+
+}
+
+std::vector<region>
+reg(const node &n)
+{
+	return decode_reg(&n);
+}
+
+size_t
+reg(const node &n, std::span<region> o)
+{
+	return decode_reg(&n, o);
+}
+
+uint64_t
+translate_address(const node &n, uint64_t a)
+{
+	return translate(&n, a);
+}
+
+namespace {
+
+/*
+ * tree_of - get tree of node which must belong to an fdt
+ */
+dtl::tree &
+tree_of(const node &n)
+{
+	if (const auto &t{dtl::tree::of(n)}; t)
+		return *t;
+	throw std::invalid_argument{"node does not belong to an fdt"};
+}
+
+/*
+ * interrupt_parent - get interrupt parent of node, nullptr if none
+ */
+const node *
+interrupt_parent(dtl::tree &t, const node &n)
+{
+	const node *c{&n};
+	do {
+		if (const auto &p{find_child(*c, "interrupt-parent")};
+		    p && is_property(*p)) {
+			c = t.phandle(as<uint32_t>(as_property(*p)));
+			if (!c)
+				throw std::invalid_argument{"interrupt-parent not found"};
+		} else if (const auto &pn{parent(*c)}; pn)
+			c = &pn->get();
+		else
+			return nullptr;
+	} while (!find_child(*c, "#interrupt-cells"));
+	return c;
+}
+
+/*
+ * resolve_interrupt - map interrupt of child of p to interrupt controller
+ */
+interrupt
+resolve_interrupt(dtl::tree &t, const node *p,
+		  std::span<const uint32_t> address,
+		  std::span<const uint32_t> specifier)
+{
+	constexpr auto max_cells{4 + max_interrupt_cells};
+	if (size(address) > 4 || size(specifier) > max_interrupt_cells)
+		throw std::invalid_argument{"unsupported cell count"};
+	std::array<uint32_t, max_cells> a, s, key;
+	auto na{size(address)}, ns{size(specifier)};
+	std::copy(begin(address), end(address), begin(a));
+	std::copy(begin(specifier), end(specifier), begin(s));
+
+	/* limit depth in case the interrupt tree has a loop */
+	for (unsigned depth{0}; depth != 64; ++depth) {
+		if (!p)
+			throw std::invalid_argument{"no interrupt parent"};
+		if (find_child(*p, "interrupt-controller"))
+			return {*p, {begin(s), begin(s) + ns}};
+		const auto m{t.interrupt_map(*p)};
+		if (!m) {
+			p = interrupt_parent(t, *p);
+			continue;
+		}
+		if (ns != m->interrupt_cells)
+			throw std::invalid_argument{"bad interrupt specifier"};
+		size_t nk{0};
+		for (unsigned i{0}; i != m->address_cells; ++i, ++nk)
+			key[nk] = (i < na ? a[i] : 0) & m->mask[nk];
+		for (unsigned i{0}; i != ns; ++i, ++nk)
+			key[nk] = s[i] & m->mask[nk];
+		const auto e{m->find({data(key), nk})};
+		if (!e)
+			throw std::invalid_argument{"interrupt not mapped"};
+		const auto pc{begin(m->cells) + e->parent_address};
+		na = e->parent_address_cells;
+		ns = e->parent_interrupt_cells;
+		std::copy(pc, pc + na, begin(a));
+		std::copy(pc + na, pc + na + ns, begin(s));
+		p = e->parent;
+	}
+	throw std::invalid_argument{"interrupt tree too deep"};
+}
+
+}
+
+std::vector<interrupt>
+interrupts(const node &n)
+{
+	auto &t{tree_of(n)};
+	std::vector<interrupt> r;
+
+	/* unit address for interrupt-map lookups */
+	std::array<uint32_t, 4> ua{};
+	size_t nua{0};
+	if (const auto &rp{find_child(n, "reg")}; rp && is_property(*rp)) {
+		auto v{as_bytes(as_property(*rp))};
+		for (; nua != size(ua) && size(v) >= sizeof(uint32_t); ++nua)
+			ua[nua] = dtl::read_advance<uint32_t>(v);
+	}
+
+	std::array<uint32_t, max_interrupt_cells> s;
+	if (const auto &ie{find_child(n, "interrupts-extended")};
+	    ie && is_property(*ie)) {
+		auto v{as_bytes(as_property(*ie))};
+		while (!empty(v)) {
+			if (size(v) < sizeof(uint32_t))
+				throw std::invalid_argument{"bad interrupts-extended"};
+			const auto p{t.phandle(dtl::read_advance<uint32_t>(v))};
+			if (!p)
+				throw std::invalid_argument{"interrupt parent not found"};
+			const auto ic{interrupt_cells(*p)};
+			if (size(v) < ic * sizeof(uint32_t))
+				throw std::invalid_argument{"bad interrupts-extended"};
+			for (unsigned i{0}; i != ic; ++i)
+				s[i] = dtl::read_advance<uint32_t>(v);
+			r.push_back(resolve_interrupt(t, p, {data(ua), nua},
+						      {data(s), ic}));
+		}
+		return r;
+	}
+
+	const auto &ip{find_child(n, "interrupts")};
+	if (!ip || !is_property(*ip))
+		return r;
+	const auto p{interrupt_parent(t, n)};
+	if (!p)
+		throw std::invalid_argument{"no interrupt parent"};
+	const auto ic{interrupt_cells(*p)};
+	auto v{as_bytes(as_property(*ip))};
+	if (!ic || size(v) % (ic * sizeof(uint32_t)))
+		throw std::invalid_argument{"bad interrupts"};
+	r.reserve(size(v) / (ic * sizeof(uint32_t)));
+	while (!empty(v)) {
+		for (unsigned i{0}; i != ic; ++i)
+			s[i] = dtl::read_advance<uint32_t>(v);
+		r.push_back(resolve_interrupt(t, p, {data(ua), nua},
+					      {data(s), ic}));
+	}
+	return r;
+}
+
+interrupt
+map_interrupt(const node &p, std::span<const uint32_t> address,
+	      std::span<const uint32_t> specifier)
+{
+	return resolve_interrupt(tree_of(p), &p, address, specifier);
+}
+
+namespace {
+
+/*
+ * node_pool - work sharing pool for parallel_for_each_node
+ *
+ * Each thread works depth first on its own stack of nodes without locking.
+ * While other threads are idle, a busy thread moves the older half of its
+ * stack, which holds the largest untouched subtrees, to the shared queue in
+ * one batch. Idle threads sleep until work is shared or the last node is
+ * done.
+ */
+class node_pool {
+public:
+	node_pool(unsigned threads, const std::function<void(const node &)> &fn)
+	: fn_{fn}
+	, threads_{threads}
+	{ }
+
+	void
+	run(const node &n)
+	{
+		pending_ = 1;
+		std::vector<std::thread> t;
+		t.reserve(threads_ - 1);
+		for (unsigned i{1}; i != threads_; ++i) {
+			try {
+				t.emplace_back(&node_pool::work, this, nullptr);
+			} catch (const std::system_error &) {
+				/* carry on with the threads already started */
+				break;
+			}
+		}
+		/* threads started above only return once this finishes the tree */
+		work(&n);
+		for (auto &th : t)
+			th.join();
+		if (error_)
+			std::rethrow_exception(error_);
+	}
+
+private:
+	void
+	work(const node *start)
+	{
+		std::vector<const node *> local;
+		if (start)
+			local.push_back(start);
+		for (;;) {
+			if (local.empty() && !take(local))
+				return;
+			const auto n{local.back()};
+			local.pop_back();
+			const auto b{size(local)};
+			if (!failed_) {
+				try {
+					fn_(*n);
+					for (const auto &sn : subnodes(*n))
+						local.push_back(&sn);
+				} catch (...) {
+					local.resize(b);
+					std::lock_guard l{lock_};
+					if (!error_)
+						error_ = std::current_exception();
+					failed_ = true;
+				}
+			}
+			/* count subnodes before they can be shared */
+			pending_ += size(local) - b;
+			if (idle_ && size(local) > 1)
+				share(local);
+			if (!--pending_) {
+				/* lock so that no waiter misses the wakeup */
+				{ std::lock_guard l{lock_}; }
+				ready_.notify_all();
+			}
+		}
+	}
+
+	/* move older half of local stack to shared queue */
+	void
+	share(std::vector<const node *> &local) noexcept
+	{
+		const auto h{begin(local) + size(local) / 2};
+		try {
+			std::lock_guard l{lock_};
+			shared_.insert(end(shared_), begin(local), h);
+		} catch (const std::bad_alloc &) {
+			/* keep working on them locally */
+			return;
+		}
+		local.erase(begin(local), h);
+		ready_.notify_all();
+	}
+
+	/* wait for shared work, returns false once all nodes are done */
+	bool
+	take(std::vector<const node *> &local)
+	{
+		std::unique_lock l{lock_};
+		++idle_;
+		ready_.wait(l, [&] { return !shared_.empty() || !pending_; });
+		--idle_;
+		if (shared_.empty())
+			return false;
+		/* leave some for other idle threads */
+		const auto c{std::max<size_t>(1, size(shared_) / (idle_ + 1))};
+		local.assign(begin(shared_), begin(shared_) + c);
+		shared_.erase(begin(shared_), begin(shared_) + c);
+		return true;
+	}
+
+	const std::function<void(const node &)> &fn_;
+	const unsigned threads_;
+	std::mutex lock_;
+	std::condition_variable ready_;
+	std::deque<const node *> shared_;
+	std::atomic<size_t> pending_{0};
+	std::atomic<unsigned> idle_{0};
+	std::atomic<bool> failed_{false};
+	std::exception_ptr error_;
+};
+
+}
+
+void
+parallel_for_each_node(const node &n,
+		       const std::function<void(const node &)> &fn,
+		       unsigned threads)
+{
+	if (!threads)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	if (threads == 1) {
+		for_each_node(n, fn);
+		return;
+	}
+	node_pool{threads, fn}.run(n);
+}
+
+bool
+contains(const node &n, std::string_view path)
+{
+	return find(n, path).has_value();
+}
+
+std::optional<std::reference_wrapper<const piece>>
+find(const node &n, std::string_view path)
+{
+	return to_optional(find_impl(n, path));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(node &n, std::string_view path)
+{
+	return to_optional(find_impl(n, path));
+}
+
+node &
+get_node(node &n, std::string_view path)
+{
+	return as_node(find(n, path).value());
+}
+
+const node &
+get_node(const node &n, std::string_view path)
+{
+	return as_node(find(n, path).value());
+}
+
+property &
+get_property(node &n, std::string_view path)
+{
+	return as_property(find(n, path).value());
+}
+
+const property &
+get_property(const node &n, std::string_view path)
+{
+	return as_property(find(n, path).value());
+}
+
+result<std::reference_wrapper<const piece>>
+try_find(const node &n, std::string_view path)
+{
+	return find_impl(n, path);
+}
+
+result<std::reference_wrapper<piece>>
+try_find(node &n, std::string_view path)
+{
+	return find_impl(n, path);
+}
+
+result<std::reference_wrapper<const node>>
+try_get_node(const node &n, std::string_view path)
+{
+	return to_node(find_impl(n, path));
+}
+
+result<std::reference_wrapper<node>>
+try_get_node(node &n, std::string_view path)
+{
+	return to_node(find_impl(n, path));
+}
+
+result<std::reference_wrapper<const property>>
+try_get_property(const node &n, std::string_view path)
+{
+	return to_property(find_impl(n, path));
+}
+
+result<std::reference_wrapper<property>>
+try_get_property(node &n, std::string_view path)
+{
+	return to_property(find_impl(n, path));
+}
+
+/*
+ * selector
+ */
+namespace {
+
+/*
+ * glob - match name against pattern with '*' and '?' wildcards
+ */
+bool
+glob(std::string_view p, std::string_view s)
+{
+	constexpr auto npos{std::string_view::npos};
+	size_t pi{0}, si{0}, star{npos}, mark{0};
+	while (si != size(s)) {
+		if (pi != size(p) && (p[pi] == '?' || p[pi] == s[si])) {
+			++pi;
+			++si;
+		} else if (pi != size(p) && p[pi] == '*') {
+			star = pi++;
+			mark = si;
+		} else if (star != npos) {
+			pi = star + 1;
+			si = ++mark;
+		} else
+			return false;
+	}
+	while (pi != size(p) && p[pi] == '*')
+		++pi;
+	return pi == size(p);
+}
+
+/*
+ * preorder_before - test if piece l is visited before r by preorder
+ *
+ * l and r are the chains of pieces from below a common start node down to
+ * each piece. At the first difference properties come before nodes, then
+ * names are in order.
+ */
+bool
+preorder_before(std::span<const piece *const> l,
+		std::span<const piece *const> r)
+{
+	const auto [li, ri] = std::mismatch(begin(l), end(l), begin(r), end(r));
+	if (li == end(l))
+		return ri != end(r);
+	if (ri == end(r))
+		return false;
+	return std::pair{is_node(**li), name(**li)} <
+	       std::pair{is_node(**ri), name(**ri)};
+}
+
+}
+
+selector::selector(std::string_view s)
+{
+	auto bad = [] { throw std::invalid_argument{"bad selector"}; };
+
+	if (s.starts_with('/'))
+		s.remove_prefix(1);
+	bool descendant{false};
+	while (!empty(s)) {
+		step st;
+		const auto e{std::min(s.find_first_of("/["), size(s))};
+		st.pattern = s.substr(0, e);
+		s.remove_prefix(e);
+		if (empty(st.pattern)) {
+			/* empty component before '/' is a descendant step */
+			if (descendant || !s.starts_with('/'))
+				bad();
+			descendant = true;
+			s.remove_prefix(1);
+			continue;
+		}
+		st.descendant = std::exchange(descendant, false);
+		st.prefix = std::min(st.pattern.find_first_of("*?"),
+				     size(st.pattern));
+
+		while (s.starts_with('[')) {
+			s.remove_prefix(1);
+			const auto pe{s.find_first_of("=]")};
+			if (pe == std::string_view::npos || !pe)
+				bad();
+			predicate p{std::string{s.substr(0, pe)}, std::nullopt};
+			s.remove_prefix(pe);
+			if (s.starts_with('=')) {
+				s.remove_prefix(1);
+				const auto q{s.find('"', 1)};
+				if (!s.starts_with('"') || q == std::string_view::npos)
+					bad();
+				p.value = s.substr(1, q - 1);
+				s.remove_prefix(q + 1);
+			}
+			if (!s.starts_with(']'))
+				bad();
+			s.remove_prefix(1);
+			st.predicates.push_back(std::move(p));
+		}
+
+		if (!empty(s) && !s.starts_with('/'))
+			bad();
+		if (!empty(s))
+			s.remove_prefix(1);
+		steps_.push_back(std::move(st));
+	}
+	if (descendant)
+		bad();
+}
+
+/*
+ * matches - test if piece matches step
+ */
+bool
+selector::matches(const step &s, const piece &p)
+{
+	if (!glob(s.pattern, name(p)))
+		return false;
+	if (empty(s.predicates))
+		return true;
+	if (!is_node(p))
+		return false;
+	for (const auto &pr : s.predicates) {
+		const auto &c{find_child(as_node(p), pr.property)};
+		if (!c || !is_property(*c))
+			return false;
+		if (!pr.value)
+			continue;
+		const auto &cp{as_property(*c)};
+		if (!is_stringlist(cp))
+			return false;
+		const auto &l{as_stringlist(cp)};
+		if (std::find(begin(l), end(l), *pr.value) == end(l))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * select - evaluate selector one step at a time
+ *
+ * Each step visits the children of the nodes matched by the previous step,
+ * or all nodes below them for descendant steps, starting from the first
+ * child which could match the literal prefix of the step pattern.
+ */
+template<class Piece, class Node>
+std::vector<std::reference_wrapper<Piece>>
+selector::select(Node &start) const
+{
+	std::vector<std::reference_wrapper<Piece>> r;
+	if (empty(steps_)) {
+		r.push_back(start);
+		return r;
+	}
+
+	std::vector<Node *> cur{&start}, next;
+	std::unordered_set<const piece *> seen;
+	for (size_t i{0}; i != size(steps_); ++i) {
+		const auto &s{steps_[i]};
+		const auto last{i + 1 == size(steps_)};
+		const std::string_view pre{data(s.pattern), s.prefix};
+		next.clear();
+		seen.clear();
+
+		auto visit = [&](Node &n) {
+			const auto &c{n.children_};
+			for (auto it{c.lower_bound(pre)};
+			     it != end(c) && name(**it).starts_with(pre); ++it) {
+				Piece &p{**it};
+				if (!matches(s, p) || !seen.insert(&p).second)
+					continue;
+				if (last)
+					r.push_back(p);
+				else if (is_node(p))
+					next.push_back(&as_node(p));
+			}
+		};
+
+		for (const auto n : cur) {
+			if (!s.descendant) {
+				visit(*n);
+				continue;
+			}
+			for (const auto &[p, depth] : preorder(*n))
+				if (is_node(p))
+					visit(as_node(p));
+		}
+		cur.swap(next);
+	}
+
+	/* children are visited by name and descendant steps may revisit
+	 * subtrees, so put the matches in preorder */
+	if (size(r) > 1) {
+		std::vector<std::pair<std::vector<const piece *>, Piece *>> k;
+		k.reserve(size(r));
+		for (Piece &p : r) {
+			std::vector<const piece *> c;
+			for (const piece *q{&p}; q != &start; q = &parent(*q)->get())
+				c.push_back(q);
+			std::reverse(begin(c), end(c));
+			k.emplace_back(std::move(c), &p);
+		}
+		std::sort(begin(k), end(k), [](const auto &l, const auto &r) {
+			return preorder_before(l.first, r.first);
+		});
+		for (size_t i{0}; i != size(k); ++i)
+			r[i] = *k[i].second;
+	}
+	return r;
+}
+
+std::vector<std::reference_wrapper<piece>>
+select(node &n, const selector &s)
+{
+	return s.select<piece>(n);
+}
+
+std::vector<std::reference_wrapper<const piece>>
+select(const node &n, const selector &s)
+{
+	return s.select<const piece>(n);
+}
+
+/*
+ * path_handle
+ */
+path_handle::path_handle(std::string_view path)
+: absolute_{path.starts_with('/')}
+{
+	if (absolute_)
+		path.remove_prefix(1);
+	for (;;) {
+		const auto sep{path.find('/')};
+		const auto &c{path.substr(0, sep)};
+		if (empty(c))
+			throw std::invalid_argument{"bad path"};
+		components_.emplace_back(c);
+		if (sep == std::string_view::npos)
+			break;
+		path.remove_prefix(sep + 1);
+	}
+}
+
+path_handle::path_handle(const path_handle &r)
+: absolute_{r.absolute_}
+, components_{r.components_}
+{
+	std::lock_guard l{r.lock_};
+	cache_ = r.cache_;
+}
+
+path_handle &
+path_handle::operator=(const path_handle &r)
+{
+	if (this == &r)
+		return *this;
+	absolute_ = r.absolute_;
+	components_ = r.components_;
+	std::scoped_lock l{lock_, r.lock_};
+	cache_ = r.cache_;
+	return *this;
+}
+
+/*
+ * walk - find piece without using the cache
+ */
+result<std::reference_wrapper<piece>>
+path_handle::walk(const node &start, bool fdt) const
+{
+	const auto &r{find_components(start, fdt, absolute_, components_)};
+	if (!r)
+		return dtl::fail(r.error());
+	/* pieces are never const objects, constness comes from the lookup */
+	return std::ref(const_cast<piece &>(r->get()));
+}
+
+/*
+ * resolve - find piece, reusing the last result if the tree is unchanged
+ *
+ * Generation numbers are unique across trees, so a matching generation also
+ * means the cached piece belongs to the tree of start.
+ */
+result<std::reference_wrapper<piece>>
+path_handle::resolve(const node &start, bool fdt) const
+{
+	const auto t{dtl::tree::of(start)};
+	if (!t)
+		return walk(start, fdt);
+	const uint64_t g{t->generation};
+	{
+		std::lock_guard l{lock_};
+		const auto &c{cache_};
+		if (c.start == &start && c.fdt == fdt && c.generation == g) {
+			if (!c.found)
+				return dtl::fail(c.error);
+			return std::ref(*c.found);
+		}
+	}
+	/* walk unlocked, lookups of other trees need not wait */
+	const auto &r{walk(start, fdt)};
+	std::lock_guard l{lock_};
+	cache_ = {&start, fdt, g, r ? &r->get() : nullptr,
+		  r ? errc{} : r.error()};
+	return r;
+}
+
+std::optional<std::reference_wrapper<const piece>>
+find(const node &n, const path_handle &h)
+{
+	return to_optional(h.resolve(n, false));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(node &n, const path_handle &h)
+{
+	return to_optional(h.resolve(n, false));
+}
+
+/*
+ * path_literal
+ */
+std::optional<std::reference_wrapper<const piece>>
+find(const node &n, const path_literal &p)
+{
+	return to_optional(find_components(n, false, p.absolute(), p.components()));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(node &n, const path_literal &p)
+{
+	return to_optional(find_components(n, false, p.absolute(), p.components()));
+}
+
+node &
+get_node(node &n, const path_literal &p)
+{
+	return as_node(find(n, p).value());
+}
+
+const node &
+get_node(const node &n, const path_literal &p)
+{
+	return as_node(find(n, p).value());
+}
+
+property &
+get_property(node &n, const path_literal &p)
+{
+	return as_property(find(n, p).value());
+}
+
+const property &
+get_property(const node &n, const path_literal &p)
+{
+	return as_property(find(n, p).value());
+}
+
+/*
+ * dtl
+ */
+void
+dtl::byteswap_copy(std::byte *d, const std::byte *s, size_t n, size_t width)
+{
+	if (std::endian::native == std::endian::big || width == 1) {
+		std::copy_n(s, n * width, d);
+		return;
+	}
+	switch (width) {
+	case 2:
+		return byteswap_values<2>(d, s, n);
+	case 4:
+		return byteswap_values<4>(d, s, n);
+	case 8:
+		return byteswap_values<8>(d, s, n);
+	default:
+		throw std::invalid_argument{"can't byteswap width"};
+	}
+}
+
+/*
+ * fdt
+ */
+fdt::fdt()
+: fdt{std::pmr::get_default_resource()}
+{ }
+
+fdt::fdt(std::pmr::memory_resource *r)
+: tree_{std::pmr::polymorphic_allocator<>{r}.new_object<dtl::tree>(r)}
+{ }
+
+fdt::fdt(fdt &&) = default;
+fdt &fdt::operator=(fdt &&) = default;
+fdt::~fdt() = default;
+
+node &
+fdt::root()
+{
+	return tree_->root;
+}
+
+const node &
+fdt::root() const
+{
+	return tree_->root;
+}
+
+bool
+operator==(const fdt &l, const fdt &r)
+{
+	/* TODO(incomplete): memory reservation block */
+	/* TODO(incomplete): boot cpuid */
+	return l.root() == r.root();
+}
+
+fdt
+clone(const fdt &f)
 {
-	if (!is_property(r))
-		return false;
-	const auto &lv{get()};
-	const auto &rv{as_property(r).get()};
-	return std::equal(begin(lv), end(lv), begin(rv), end(rv));
+	return clone(f, resource(f));
+}
+
+fdt
+clone(const fdt &f, std::pmr::memory_resource *r)
+{
+	fdt t{r};
+	/* TODO(incomplete): clone memory reservation block */
+	/* TODO(incomplete): clone boot cpuid */
+	clone(root(f), root(t));
+	return t;
+}
+
+node &
+root(fdt &f)
+{
+	return f.root();
+}
+
+const node &
+root(const fdt &f)
+{
+	return f.root();
+}
+
+std::pmr::memory_resource *
+resource(const fdt &f)
+{
+	return resource(root(f));
+}
+
+fdt
+load(std::span<const std::byte> d, std::pmr::memory_resource *res)
+{
+	/* TODO(efficiency): probably only need a minimal header check here */
+	if (auto r = fdt_check_full(data(d), size(d)); r < 0)
+		throw std::invalid_argument{fdt_strerror(r)};
+
+	fdt t{res};
+	/* TODO(incomplete): load memory reservation block */
+	/* TODO(incomplete): load boot cpuid */
+	load(d, root(t));
+	return t;
+}
+
+fdt
+load(const int fd, std::pmr::memory_resource *r)
+{
+	std::pmr::vector<std::byte> d{r};
+	read_blob(d, fd_fill(fd));
+	return load(d, r);
+}
+
+fdt
+load(const std::filesystem::path &p, std::pmr::memory_resource *r)
+{
+	std::ifstream f(p, std::ios::binary);
+	std::pmr::vector<std::byte> d{r};
+	read_blob(d, stream_fill(f));
+	return load(d, r);
+}
+
+std::pair<fdt, std::vector<std::byte>>
+load_keep(const int fd)
+{
+	std::vector<std::byte> d;
+	read_blob(d, fd_fill(fd));
+	return {load(d), std::move(d)};
+}
+
+std::pair<fdt, std::vector<std::byte>>
+load_keep(const std::filesystem::path &p)
+{
+	std::ifstream f(p, std::ios::binary);
+	std::vector<std::byte> d;
+	read_blob(d, stream_fill(f));
+	return {load(d), std::move(d)};
+}
+
+std::vector<std::byte>
+save(const fdt &f)
+{
+	/* REVISIT: this is far from optimal but it's about as good as we can
+	 * get without reimplementing libfdt */
+	std::vector<std::byte> t{4000};
+	fdt_create(t);
+	/* TODO(incomplete): save memory reservation block */
+	/* TODO(incomplete): save boot cpuid */
+	fdt_finish_reservemap(t);
+	save(root(f), t);
+	fdt_finish(t);
+	t.resize(fdt_totalsize(data(t)));
+	return t;
+}
+
+void
+apply_overlay(fdt &f, const fdt &o)
+{
+	overlay{f, o}.apply();
+}
+
+std::optional<std::reference_wrapper<const node>>
+find_alias(const fdt &f, std::string_view alias)
+{
+	if (auto n{dtl::tree::of(root(f))->alias(alias)}; n)
+		return std::cref(*n);
+	return std::nullopt;
+}
+
+std::optional<std::reference_wrapper<node>>
+find_alias(fdt &f, std::string_view alias)
+{
+	if (auto n{dtl::tree::of(root(f))->alias(alias)}; n)
+		return std::ref(*n);
+	return std::nullopt;
+}
+
+std::optional<std::reference_wrapper<const node>>
+find_label(const fdt &f, std::string_view label)
+{
+	if (auto n{dtl::tree::of(root(f))->label(label)}; n)
+		return std::cref(*n);
+	return std::nullopt;
+}
+
+std::optional<std::reference_wrapper<node>>
+find_label(fdt &f, std::string_view label)
+{
+	if (auto n{dtl::tree::of(root(f))->label(label)}; n)
+		return std::ref(*n);
+	return std::nullopt;
+}
+
+std::optional<std::reference_wrapper<const node>>
+find_phandle(const fdt &f, uint32_t phandle)
+{
+	if (auto n{dtl::tree::of(root(f))->phandle(phandle)}; n)
+		return std::cref(*n);
+	return std::nullopt;
+}
+
+std::optional<std::reference_wrapper<node>>
+find_phandle(fdt &f, uint32_t phandle)
+{
+	if (auto n{dtl::tree::of(root(f))->phandle(phandle)}; n)
+		return std::ref(*n);
+	return std::nullopt;
+}
+
+std::vector<std::reference_wrapper<piece>>
+select(fdt &f, const selector &s)
+{
+	return select(root(f), s);
+}
+
+std::vector<std::reference_wrapper<const piece>>
+select(const fdt &f, const selector &s)
+{
+	return select(root(f), s);
+}
+
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &f, const path_handle &h)
+{
+	return to_optional(h.resolve(root(f), true));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(fdt &f, const path_handle &h)
+{
+	return to_optional(h.resolve(root(f), true));
+}
+
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &f, const path_literal &p)
+{
+	return to_optional(find_components(root(f), true, p.absolute(),
+					   p.components()));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(fdt &f, const path_literal &p)
+{
+	return to_optional(find_components(root(f), true, p.absolute(),
+					   p.components()));
+}
+
+node &
+get_node(fdt &f, const path_literal &p)
+{
+	return as_node(find(f, p).value());
+}
+
+const node &
+get_node(const fdt &f, const path_literal &p)
+{
+	return as_node(find(f, p).value());
+}
+
+property &
+get_property(fdt &f, const path_literal &p)
+{
+	return as_property(find(f, p).value());
+}
+
+const property &
+get_property(const fdt &f, const path_literal &p)
+{
+	return as_property(find(f, p).value());
+}
+
+void
+parallel_for_each_node(const fdt &f,
+		       const std::function<void(const node &)> &fn,
+		       unsigned threads)
+{
+	parallel_for_each_node(root(f), fn, threads);
+}
+
+bool
+contains(const fdt &f, std::string_view path)
+{
+	return find(f, path).has_value();
+}
+
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &f, std::string_view path)
+{
+	return to_optional(find_fdt(f, path));
+}
+
+std::optional<std::reference_wrapper<piece>>
+find(fdt &f, std::string_view path)
+{
+	return to_optional(find_fdt(f, path));
+}
+
+node &
+get_node(fdt &f, std::string_view path)
+{
+	return as_node(find(f, path).value());
+}
+
+const node &
+get_node(const fdt &f, std::string_view path)
+{
+	return as_node(find(f, path).value());
+}
+
+property &
+get_property(fdt &f, std::string_view path)
+{
+	return as_property(find(f, path).value());
+}
+
+const property &
+get_property(const fdt &f, std::string_view path)
+{
+	return as_property(find(f, path).value());
+}
+
+result<std::reference_wrapper<const piece>>
+try_find(const fdt &f, std::string_view path)
+{
+	return try_find_fdt(f, path);
+}
+
+result<std::reference_wrapper<piece>>
+try_find(fdt &f, std::string_view path)
+{
+	return try_find_fdt(f, path);
+}
+
+result<std::reference_wrapper<const node>>
+try_get_node(const fdt &f, std::string_view path)
+{
+	return to_node(try_find_fdt(f, path));
+}
+
+result<std::reference_wrapper<node>>
+try_get_node(fdt &f, std::string_view path)
+{
+	return to_node(try_find_fdt(f, path));
+}
+
+result<std::reference_wrapper<const property>>
+try_get_property(const fdt &f, std::string_view path)
+{
+	return to_property(try_find_fdt(f, path));
+}
+
+result<std::reference_wrapper<property>>
+try_get_property(fdt &f, std::string_view path)
+{
+	return to_property(try_find_fdt(f, path));
+}
+
+/*
+ * dtl::compact_pool - properties, names and values of compact and frozen trees
+ *
+ * The property table ends with a sentinel record, so the value of record i
+ * ends where the value of record i + 1 begins. Each string is preceded by
+ * its length so that name lookups do not scan for terminators.
+ */
+struct dtl::compact_pool {
+	static constexpr uint32_t none{UINT32_MAX};
+
+	struct property_record {
+		uint32_t name;
+		uint32_t value;
+	};
+
+	std::string_view string(uint32_t off) const
+	{
+		uint32_t n;
+		std::memcpy(&n, data(strings) + off, sizeof(n));
+		return {data(strings) + off + sizeof(n), n};
+	}
+
+	std::vector<property_record> properties;
+	std::vector<char> strings;
+	std::vector<std::byte> values;
+};
+
+/*
+ * dtl::compact_tables - tables of a compact_fdt
+ *
+ * The node table ends with a sentinel record, so the subnodes and properties
+ * of record i end where those of record i + 1 begin.
+ */
+struct dtl::compact_tables : compact_pool {
+	struct node_record {
+		uint32_t name;
+		uint32_t parent;
+		uint32_t subnodes;
+		uint32_t properties;
+	};
+
+	std::vector<node_record> nodes;
+};
+
+/*
+ * dtl::frozen_tables - tables of a frozen_fdt
+ *
+ * The node table ends with a sentinel record, so the properties of record i
+ * end where those of record i + 1 begin.
+ */
+struct dtl::frozen_tables : compact_pool {
+	struct node_record {
+		uint32_t name;
+		uint32_t parent;
+		uint32_t end;		/* index after subtree */
+		uint32_t properties;
+	};
+
+	std::vector<node_record> nodes;
+};
+
+namespace {
+
+/*
+ * index32 - check that index fits in a compact table
+ */
+uint32_t
+index32(size_t i)
+{
+	if (i >= dtl::compact_pool::none)
+		throw std::invalid_argument{"tree too large"};
+	return static_cast<uint32_t>(i);
+}
+
+/*
+ * table_builder - build compact or frozen tables
+ *
+ * Each node must be followed by its properties sorted by name. Names are
+ * stored once each and must remain valid until the tables are finished.
+ */
+template<class T>
+class table_builder {
+public:
+	uint32_t add_node(std::string_view name, size_t parent, size_t link)
+	{
+		t_->nodes.push_back({intern(name), static_cast<uint32_t>(parent),
+				     index32(link),
+				     index32(size(t_->properties))});
+		return index32(size(t_->nodes) - 1);
+	}
+
+	void add_property(std::string_view name, std::span<const std::byte> v)
+	{
+		t_->properties.push_back({intern(name),
+					  index32(size(t_->values))});
+		t_->values.insert(end(t_->values), begin(v), end(v));
+	}
+
+	std::unique_ptr<T> finish()
+	{
+		t_->nodes.push_back({0, dtl::compact_pool::none,
+				     index32(size(t_->nodes)),
+				     index32(size(t_->properties))});
+		t_->properties.push_back({0, index32(size(t_->values))});
+		t_->nodes.shrink_to_fit();
+		t_->properties.shrink_to_fit();
+		t_->strings.shrink_to_fit();
+		t_->values.shrink_to_fit();
+		return std::move(t_);
+	}
+
+	T &tables() { return *t_; }
+
+private:
+	uint32_t intern(std::string_view s)
+	{
+		const auto [it, added] = strings_.try_emplace(s, 0);
+		if (added) {
+			it->second = index32(size(t_->strings));
+			const auto n{index32(size(s))};
+			const auto l{reinterpret_cast<const char *>(&n)};
+			t_->strings.insert(end(t_->strings), l, l + sizeof(n));
+			t_->strings.insert(end(t_->strings), begin(s), end(s));
+		}
+		return it->second;
+	}
+
+	std::unique_ptr<T> t_{std::make_unique<T>()};
+	std::unordered_map<std::string_view, uint32_t> strings_;
+};
+
+/*
+ * tables_size - get bytes used by tables
+ */
+template<class T>
+size_t
+tables_size(const T &t)
+{
+	return sizeof(t) +
+	       t.nodes.capacity() * sizeof(typename T::node_record) +
+	       t.properties.capacity() *
+		   sizeof(dtl::compact_pool::property_record) +
+	       t.strings.capacity() + t.values.capacity();
+}
+
+/*
+ * record - get table record of compact or frozen node
+ */
+template<class N>
+const auto &
+record(N n)
+{
+	return n.tables->nodes[n.index];
+}
+
+/*
+ * table_bound - first record in [first, last) with name not less than k
+ */
+template<class Records, class Key>
+uint32_t
+table_bound(const dtl::compact_pool &t, const Records &r, uint32_t first,
+	    uint32_t last, const Key &k)
+{
+	while (first != last) {
+		const auto m{first + (last - first) / 2};
+		if (t.string(r[m].name) < k)
+			first = m + 1;
+		else
+			last = m;
+	}
+	return first;
 }
 
-void
-property::set(std::span<const std::byte> v)
-{
-	value_.assign(begin(v), end(v));
+/*
+ * table_step - find subnode of compact or frozen node by path component
+ */
+result<compact_node>
+table_step(compact_node n, std::string_view c)
+{
+	if (empty(c))
+		return dtl::fail(errc::bad_path);
+	const auto &t{*n.tables};
+	const auto f{t.nodes[n.index].subnodes};
+	const auto l{t.nodes[n.index + 1].subnodes};
+	if (const auto i{table_bound(t, t.nodes, f, l, c)};
+	    i != l && t.string(t.nodes[i].name) == c)
+		return compact_node{&t, i};
+	/* unit address is optional in node name if unambiguous */
+	const auto first{table_bound(t, t.nodes, f, l, dtl::unit_bound{c, '@'})};
+	const auto last{table_bound(t, t.nodes, first, l,
+				    dtl::unit_bound{c, '@' + 1})};
+	if (first == last)
+		return dtl::fail(errc::not_found);
+	if (last - first != 1)
+		return dtl::fail(errc::ambiguous_path);
+	return compact_node{&t, first};
+}
+
+result<frozen_node>
+table_step(frozen_node n, std::string_view c)
+{
+	if (empty(c))
+		return dtl::fail(errc::bad_path);
+	/* siblings are not contiguous so search them in order */
+	std::optional<frozen_node> r;
+	for (const auto s : subnodes(n)) {
+		const auto &sn{name(s)};
+		if (sn == c)
+			return s;
+		if (sn.starts_with(c) && size(sn) > size(c) && sn[size(c)] == '@') {
+			if (r)
+				return dtl::fail(errc::ambiguous_path);
+			r = s;
+		}
+	}
+	if (!r)
+		return dtl::fail(errc::not_found);
+	return *r;
 }
 
-void
-set(property &p, uint32_t v)
+/*
+ * table_parent - find node containing last component of path
+ */
+template<class N>
+result<N>
+table_parent(N n, std::string_view &path)
+{
+	for (auto sep{path.find('/')}; sep != std::string_view::npos;
+	    sep = path.find('/')) {
+		const auto &r{table_step(n, path.substr(0, sep))};
+		if (!r)
+			return r;
+		n = *r;
+		path.remove_prefix(sep + 1);
+	}
+	return n;
+}
+
+template<class N>
+result<N>
+table_node(N n, std::string_view path)
 {
-	v = cpu_to_fdt32(v);
-	set(p, {reinterpret_cast<std::byte *>(&v), sizeof(v)});
+	const auto &p{table_parent(n, path)};
+	if (!p)
+		return p;
+	return table_step(*p, path);
 }
 
-void
-set(property &p, uint64_t v)
+template<class N>
+result<compact_property>
+table_property(N n, std::string_view path)
 {
-	v = cpu_to_fdt64(v);
-	set(p, {reinterpret_cast<std::byte *>(&v), sizeof(v)});
+	const auto &p{table_parent(n, path)};
+	if (!p)
+		return dtl::fail(p.error());
+	if (empty(path))
+		return dtl::fail(errc::bad_path);
+	const auto &t{*n.tables};
+	const auto f{t.nodes[p->index].properties};
+	const auto l{t.nodes[p->index + 1].properties};
+	const auto i{table_bound(t, t.properties, f, l, path)};
+	if (i == l || t.string(t.properties[i].name) != path)
+		return dtl::fail(errc::not_found);
+	return compact_property{&t, i};
 }
 
-void
-set(property &p, std::string_view v)
+template<class T>
+T
+table_value(const result<T> &r)
 {
-	/* string is empty or null teriminated, ok to assign */
-	if (empty(v) || v.back() == 0) {
-		set(p, {data(v), size(v)});
-		return;
-	}
+	if (r)
+		return *r;
+	if (r.error() == errc::bad_path)
+		throw std::invalid_argument{"bad path"};
+	if (r.error() == errc::ambiguous_path)
+		throw std::invalid_argument{"ambiguous path"};
+	throw std::bad_optional_access{};
+}
 
-	/* string is not null terminated, create a temporary then assign */
-	std::vector<std::byte> t;
-	const std::byte *b = reinterpret_cast<const std::byte *>(data(v));
-	t.insert(end(t), b, b + size(v));
-	t.emplace_back(0_byte);
-	set(p, std::move(t));
+/*
+ * table_parent_of - get parent of compact or frozen node
+ */
+template<class N>
+std::optional<N>
+table_parent_of(N n)
+{
+	const auto p{record(n).parent};
+	if (p == dtl::compact_pool::none)
+		return std::nullopt;
+	return N{n.tables, p};
 }
 
-void
-set(property &p, const std::vector<std::string_view> &v)
+template<class N>
+dtl::compact_range<compact_property>
+table_properties(N n)
 {
-	std::vector<std::byte> t;
-	for (const auto &s : v) {
-		if (empty(s))
-			continue;
-		const std::byte *b = reinterpret_cast<const std::byte *>(data(s));
-		t.insert(end(t), b, b + size(s));
-		if (s.back() != 0)
-			t.emplace_back(0_byte);
-	}
-	set(p, std::move(t));
+	return {n.tables, record(n).properties,
+		n.tables->nodes[n.index + 1].properties};
 }
 
-void
-set(property &p, property::container &&v)
+/*
+ * bus_parent, bus_property - compact and frozen node handles
+ */
+std::optional<compact_node>
+bus_parent(compact_node n)
 {
-	p.set(std::move(v));
+	return table_parent_of(n);
 }
 
-void
-set(property &p, std::span<const std::byte> v)
+std::optional<std::span<const std::byte>>
+bus_property(compact_node n, std::string_view name)
 {
-	p.set(v);
+	const auto &p{table_property(n, name)};
+	if (!p)
+		return std::nullopt;
+	return as_bytes(*p);
 }
 
-bool
-is_empty(const property &p)
+std::optional<frozen_node>
+bus_parent(frozen_node n)
 {
-	return empty(as_bytes(p));
+	return table_parent_of(n);
 }
 
-bool
-is_string(const property &p)
+std::optional<std::span<const std::byte>>
+bus_property(frozen_node n, std::string_view name)
 {
-	/* must be null terminated with no embedded nulls */
-	const auto &v = as_bytes(p);
-	if (size(v) < 2)
-		return false;
-	if (find(begin(v), end(v), 0_byte) != end(v) - 1)
-		return false;
-	return true;
+	const auto &p{table_property(n, name)};
+	if (!p)
+		return std::nullopt;
+	return as_bytes(*p);
 }
 
+template<class N>
 bool
-is_stringlist(const property &p)
+table_compatible(N n, std::string_view c)
 {
-	/* must be null terminated, may have embedded nulls, must not be
-	 * all null */
-	const auto &v = as_bytes(p);
-	if (size(v) < 2)
+	const auto &p{table_property(n, "compatible")};
+	if (!p)
 		return false;
-	if (v.back() != 0_byte)
-		return false;
-	return std::find_if_not(begin(v), end(v), is_0_byte) != end(v);
+	const auto &v{as_bytes(*p)};
+	std::string_view s{reinterpret_cast<const char *>(data(v)), size(v)};
+	while (!empty(s))
+		if (dtl::next_string(s) == c)
+			return true;
+	return false;
+}
+
 }
 
 /*
- * as_*
+ * compact_fdt
  */
-std::string_view
-as_string(const property &p)
+compact_fdt::compact_fdt(std::unique_ptr<dtl::compact_tables> t)
+: tables_{std::move(t)}
+{ }
+
+compact_fdt::compact_fdt(compact_fdt &&) = default;
+compact_fdt &compact_fdt::operator=(compact_fdt &&) = default;
+compact_fdt::~compact_fdt() = default;
+
+compact_node
+compact_fdt::root() const
 {
-	/* REVISIT: expensive sanity check could be optional? */
-	if (!is_string(p))
-		throw std::invalid_argument{"not a string"};
-	const auto &v = as_bytes(p);
-	return {reinterpret_cast<const char *>(data(v)), size(v) - 1};
+	return {tables_.get(), 0};
 }
 
-std::vector<std::string_view>
-as_stringlist(const property &p)
+size_t
+compact_fdt::size() const
 {
-	/* REVISIT: expensive sanity check could be optional? */
-	if (!is_stringlist(p))
-		throw std::invalid_argument{"not a stringlist"};
-	std::vector<std::string_view> t;
-	const auto &v = as_bytes(p);
-	const char *d = reinterpret_cast<const char *>(data(v));
-	for (auto it = begin(v); it != end(v);) {
-		auto e = std::find(it, end(v), 0_byte) + 1;
-		if (e - it > 1)
-			t.emplace_back(d + (it - begin(v)), e - it - 1);
-		it = e;
+	return tables_size(*tables_);
+}
+
+compact_fdt
+compact(const fdt &f)
+{
+	table_builder<dtl::compact_tables> b;
+	std::deque<std::pair<const node *, size_t>> q{
+		{&root(f), dtl::compact_pool::none}};
+	size_t next{1};
+	for (size_t i{0}; !empty(q); ++i) {
+		const auto [n, p] = q.front();
+		q.pop_front();
+		b.add_node(name(*n), p, next);
+		for (const auto &sn : subnodes(*n)) {
+			q.emplace_back(&sn, i);
+			++next;
+		}
+		for (const auto &pp : properties(*n))
+			b.add_property(name(pp), as_bytes(pp));
 	}
-	return t;
+	return compact_fdt{b.finish()};
 }
 
-std::span<const std::byte>
-as_bytes(const property &p)
+compact_fdt
+load_compact(std::span<const std::byte> d)
 {
-	return p.get();
+	if (auto r = fdt_check_full(data(d), size(d)); r < 0)
+		throw std::invalid_argument{fdt_strerror(r)};
+
+	/* nodes are visited breadth first like compact, with subnodes and
+	 * properties sorted by name as in a node */
+	const void *p = data(d);
+	table_builder<dtl::compact_tables> b;
+	std::deque<std::pair<int, size_t>> q{{0, dtl::compact_pool::none}};
+	std::vector<std::pair<std::string_view, int>> sn;
+	std::vector<std::pair<std::string_view, std::span<const std::byte>>> sp;
+	auto by_name = [](const auto &l, const auto &r) {
+		return l.first < r.first;
+	};
+	size_t next{1};
+	for (size_t i{0}; !empty(q); ++i) {
+		const auto [off, pi] = q.front();
+		q.pop_front();
+		int len;
+		const char *name = fdt_get_name(p, off, &len);
+		if (!name)
+			throw std::invalid_argument{fdt_strerror(len)};
+		b.add_node({name, static_cast<size_t>(len)}, pi, next);
+
+		int o;
+		sn.clear();
+		fdt_for_each_subnode(o, p, off) {
+			const char *n = fdt_get_name(p, o, &len);
+			if (!n)
+				throw std::invalid_argument{fdt_strerror(len)};
+			sn.emplace_back(std::string_view{n, static_cast<size_t>(len)},
+					o);
+		}
+		if (o < 0 && o != -FDT_ERR_NOTFOUND)
+			throw std::invalid_argument{fdt_strerror(o)};
+		std::sort(begin(sn), end(sn), by_name);
+		for (const auto &s : sn)
+			q.emplace_back(s.second, i);
+		next += size(sn);
+
+		sp.clear();
+		fdt_for_each_property_offset(o, p, off) {
+			const char *n;
+			const void *val = fdt_getprop_by_offset(p, o, &n, &len);
+			if (!val)
+				throw std::invalid_argument{fdt_strerror(len)};
+			sp.emplace_back(n, std::span{
+			    static_cast<const std::byte *>(val),
+			    static_cast<size_t>(len)});
+		}
+		if (o < 0 && o != -FDT_ERR_NOTFOUND)
+			throw std::invalid_argument{fdt_strerror(o)};
+		std::sort(begin(sp), end(sp), by_name);
+		for (const auto &[n, v] : sp)
+			b.add_property(n, v);
+	}
+	return compact_fdt{b.finish()};
 }
 
-/*
- * node
- */
-bool
-node::set_compare::operator()(const piece_p &l, const piece_p &r) const
+compact_node
+root(const compact_fdt &f)
 {
-	return l->name() < r->name();
+	return f.root();
 }
 
-node::node(node &parent, std::string_view name)
-: piece{parent, name}
+std::string_view
+name(compact_node n)
 {
-	/* REVISIT: optionally validate names? */
-	const auto &nn{node_name(*this)};
-	const auto &ua{unit_address(*this)};
-	if (size(nn) > 31)
-		throw std::invalid_argument{"node name too long"};
-	if (empty(nn) ||
-	    std::find_if_not(begin(nn), end(nn), valid_node_char) != end(nn))
-		throw std::invalid_argument{"invalid node name"};
-	if (ua.has_value() && (ua->empty() ||
-	    std::find_if_not(begin(*ua), end(*ua), valid_node_char) != end(*ua)))
-		throw std::invalid_argument{"invalid unit address"};
+	return n.tables->string(record(n).name);
 }
 
-bool
-node::v_equal(const piece &r) const
+std::string_view
+name(compact_property p)
 {
-	if (!is_node(r))
-		return false;
-	const auto &lc{children()};
-	const auto &rc{as_node(r).children()};
-	return std::equal(begin(lc), end(lc), begin(rc), end(rc));
+	return p.tables->string(p.tables->properties[p.index].name);
 }
 
-node &
-add_node(node &n, std::string_view name)
+std::optional<compact_node>
+parent(compact_node n)
 {
-	return n.add<node>(name);
+	return table_parent_of(n);
 }
 
-property &
-add_property(node &n, std::string_view name)
+dtl::compact_range<compact_node>
+subnodes(compact_node n)
 {
-	return n.add<property>(name);
+	const auto &t{*n.tables};
+	return {&t, t.nodes[n.index].subnodes, t.nodes[n.index + 1].subnodes};
 }
 
-std::string_view
-node_name(const node &n)
+dtl::compact_range<compact_property>
+properties(compact_node n)
 {
-	const auto &nn = name(n);
-	return nn.substr(0, nn.find('@'));
+	return table_properties(n);
 }
 
-std::optional<std::string_view>
-unit_address(const node &n)
+std::vector<region>
+reg(compact_node n)
 {
-	const auto &nn = name(n);
-	auto at = nn.find('@');
-	if (at == std::string_view::npos)
-		return std::nullopt;
-	return nn.substr(at + 1);
+	return decode_reg(n);
 }
 
 bool
-contains(const node &n, std::string_view path)
+is_compatible(compact_node n, std::string_view c)
 {
-	return find(n, path).has_value();
+	return table_compatible(n, c);
 }
 
-std::optional<std::reference_wrapper<const piece>>
-find(const node &n, std::string_view path)
+std::span<const std::byte>
+as_bytes(compact_property p)
 {
-	return find_impl(n, path);
+	const auto &t{*p.tables};
+	const auto f{t.properties[p.index].value};
+	const auto l{t.properties[p.index + 1].value};
+	return {data(t.values) + f, l - f};
 }
 
-std::optional<std::reference_wrapper<piece>>
-find(node &n, std::string_view path)
+std::string_view
+as_string(compact_property p)
 {
-	return find_impl(n, path);
+	const auto &v{as_bytes(p)};
+	const std::string_view s{reinterpret_cast<const char *>(data(v)), size(v)};
+	if (empty(s) || s.find('\0') != size(s) - 1)
+		throw std::invalid_argument{"not a string"};
+	return s.substr(0, size(s) - 1);
 }
 
-node &
-get_node(node &n, std::string_view path)
+result<compact_node>
+try_get_node(compact_node n, std::string_view path)
 {
-	return as_node(find(n, path).value());
+	return table_node(n, path);
 }
 
-const node &
-get_node(const node &n, std::string_view path)
+result<compact_property>
+try_get_property(compact_node n, std::string_view path)
 {
-	return as_node(find(n, path).value());
+	return table_property(n, path);
 }
 
-property &
-get_property(node &n, std::string_view path)
+compact_node
+get_node(compact_node n, std::string_view path)
 {
-	return as_property(find(n, path).value());
+	return table_value(try_get_node(n, path));
 }
 
-const property &
-get_property(const node &n, std::string_view path)
+compact_property
+get_property(compact_node n, std::string_view path)
 {
-	return as_property(find(n, path).value());
+	return table_value(try_get_property(n, path));
 }
 
 /*
- * fdt
+ * frozen_fdt
  */
-fdt::fdt()
-: root_{std::make_unique<node>()}
+frozen_fdt::frozen_fdt(std::unique_ptr<dtl::frozen_tables> t)
+: tables_{std::move(t)}
 { }
 
-node &
-fdt::root()
-{
-	return *root_;
-}
+frozen_fdt::frozen_fdt(frozen_fdt &&) = default;
+frozen_fdt &frozen_fdt::operator=(frozen_fdt &&) = default;
+frozen_fdt::~frozen_fdt() = default;
 
-const node &
-fdt::root() const
+frozen_node
+frozen_fdt::root() const
 {
-	return *root_;
+	return {tables_.get(), 0};
 }
 
-bool
-operator==(const fdt &l, const fdt &r)
+size_t
+frozen_fdt::size() const
 {
-	/* TODO(incomplete): memory reservation block */
-	/* TODO(incomplete): boot cpuid */
-	return l.root() == r.root();
+	return tables_size(*tables_);
 }
 
-node &
-root(fdt &f)
+dtl::sibling_range::iterator &
+dtl::sibling_range::iterator::operator++()
 {
-	return f.root();
+	i_ = t_->nodes[i_].end;
+	return *this;
 }
 
-const node &
-root(const fdt &f)
+frozen_fdt
+freeze(const fdt &f)
 {
-	return f.root();
+	table_builder<dtl::frozen_tables> b;
+	std::vector<std::pair<const node *, size_t>> stack{
+		{&root(f), dtl::compact_pool::none}};
+	while (!empty(stack)) {
+		const auto [n, p] = stack.back();
+		stack.pop_back();
+		const auto i{b.add_node(name(*n), p, 0)};
+		for (const auto &pp : properties(*n))
+			b.add_property(name(pp), as_bytes(pp));
+		/* push subnodes in reverse so they are popped in order */
+		const auto mark{size(stack)};
+		for (const auto &sn : subnodes(*n))
+			stack.emplace_back(&sn, i);
+		std::reverse(begin(stack) + mark, end(stack));
+	}
+
+	/* a subtree ends where the last subtree below it ends */
+	auto &nodes{b.tables().nodes};
+	for (auto &r : nodes)
+		r.end = &r - data(nodes) + 1;
+	for (auto i{size(nodes)}; i-- > 1;)
+		nodes[nodes[i].parent].end = std::max(nodes[nodes[i].parent].end,
+						      nodes[i].end);
+	return frozen_fdt{b.finish()};
 }
 
 fdt
-load(std::span<const std::byte> d)
-{
-	/* TODO(efficiency): probably only need a minimal header check here */
-	if (auto r = fdt_check_full(data(d), size(d)); r < 0)
-		throw std::invalid_argument{fdt_strerror(r)};
-
-	fdt t;
-	/* TODO(incomplete): load memory reservation block */
-	/* TODO(incomplete): load boot cpuid */
-	load(d, 0, root(t));
-	return t;
+unfreeze(const frozen_fdt &ff, std::pmr::memory_resource *r)
+{
+	fdt f{r};
+	const auto &rt{root(ff)};
+	std::pmr::vector<node *> nodes{r};
+	nodes.reserve(subtree(rt).size());
+	for (const auto n : subtree(rt)) {
+		const auto &pn{parent(n)};
+		nodes.push_back(pn ? &nodes[pn->index]->add<node>(name(n),
+							 dtl::trusted)
+				   : &root(f));
+		for (const auto p : properties(n))
+			set(nodes.back()->add<property>(name(p), dtl::trusted),
+			    as_bytes(p));
+	}
+	return f;
 }
 
-fdt
-load(const int fd)
+frozen_node
+root(const frozen_fdt &f)
 {
-	return load_keep(fd).first;
+	return f.root();
 }
 
-fdt
-load(const std::filesystem::path &p)
+std::string_view
+name(frozen_node n)
 {
-	return load_keep(p).first;
+	return n.tables->string(record(n).name);
 }
 
-std::pair<fdt, std::vector<std::byte>>
-load_keep(const int fd)
+std::optional<frozen_node>
+parent(frozen_node n)
 {
-	return load_keep([fd](size_t len, std::vector<std::byte> &d) {
-		auto off{d.size()};
-		d.resize(len);
-		while (off != len) {
-			const auto rd{read(fd, data(d) + off, len - off)};
-			if (rd < 0)
-				throw std::runtime_error{strerror(errno)};
-			if (rd == 0)
-				throw std::runtime_error{fdt_strerror(FDT_ERR_TRUNCATED)};
-			off += rd;
-		}
-	});
+	return table_parent_of(n);
 }
 
-std::pair<fdt, std::vector<std::byte>>
-load_keep(const std::filesystem::path &p)
+dtl::sibling_range
+subnodes(frozen_node n)
 {
-	std::ifstream f(p, std::ios::binary);
-	return load_keep([&](size_t len, std::vector<std::byte> &d) {
-		const auto prev{d.size()};
-		d.resize(len);
-		f.read(reinterpret_cast<char *>(data(d)) + prev, len - prev);
-		if (static_cast<size_t>(f.gcount()) != len - prev)
-			throw std::runtime_error{fdt_strerror(FDT_ERR_TRUNCATED)};
-	});
+	return {n.tables, n.index + 1, record(n).end};
 }
 
-std::vector<std::byte>
-save(const fdt &f)
+dtl::compact_range<compact_property>
+properties(frozen_node n)
 {
-	/* REVISIT: this is far from optimal but it's about as good as we can
-	 * get without reimplementing libfdt */
-	std::vector<std::byte> t{4000};
-	fdt_create(t);
-	/* TODO(incomplete): save memory reservation block */
-	/* TODO(incomplete): save boot cpuid */
-	fdt_finish_reservemap(t);
-	save(root(f), t);
-	fdt_finish(t);
-	t.resize(fdt_totalsize(data(t)));
-	return t;
+	return table_properties(n);
 }
 
-bool
-contains(const fdt &f, std::string_view path)
+dtl::compact_range<frozen_node>
+subtree(frozen_node n)
 {
-	if (!path.starts_with('/'))
-		throw std::invalid_argument{"bad path"};
-	return contains(root(f), path.substr(1));
+	return {n.tables, n.index, record(n).end};
 }
 
-std::optional<std::reference_wrapper<const piece>>
-find(const fdt &f, std::string_view path)
+std::vector<region>
+reg(frozen_node n)
 {
-	if (!path.starts_with('/'))
-		throw std::invalid_argument{"bad path"};
-	return find(root(f), path.substr(1));
-
+	return decode_reg(n);
 }
 
-std::optional<std::reference_wrapper<piece>>
-find(fdt &f, std::string_view path)
+bool
+is_compatible(frozen_node n, std::string_view c)
 {
-	if (!path.starts_with('/'))
-		throw std::invalid_argument{"bad path"};
-	return find(root(f), path.substr(1));
+	return table_compatible(n, c);
 }
 
-node &
-get_node(fdt &f, std::string_view path)
+result<frozen_node>
+try_get_node(frozen_node n, std::string_view path)
 {
-	return as_node(find(f, path).value());
+	return table_node(n, path);
 }
 
-const node &
-get_node(const fdt &f, std::string_view path)
+result<compact_property>
+try_get_property(frozen_node n, std::string_view path)
 {
-	return as_node(find(f, path).value());
+	return table_property(n, path);
 }
 
-property &
-get_property(fdt &f, std::string_view path)
+frozen_node
+get_node(frozen_node n, std::string_view path)
 {
-	return as_property(find(f, path).value());
+	return table_value(try_get_node(n, path));
 }
 
-const property &
-get_property(const fdt &f, std::string_view path)
+compact_property
+get_property(frozen_node n, std::string_view path)
 {
-	return as_property(find(f, path).value());
+	return table_value(try_get_property(n, path));
 }
 
 }
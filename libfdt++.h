@@ -7,15 +7,23 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bit>
 #include <cassert>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <span>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <version>
 
@@ -26,10 +34,88 @@
 #include <ranges>
 #endif
 
+/*
+ * Fall back to a minimal implementation if expected isn't available
+ */
+#ifdef __cpp_lib_expected
+#include <expected>
+#else
+#include <variant>
+#endif
+
 namespace fdt {
 
+class fdt;
 class node;
+class piece;
 class property;
+class selector;
+template<class T> class be_span;
+
+namespace dtl {
+struct tree;
+/* deleters returning trees and pieces to the resource they came from */
+struct tree_delete { void operator()(tree *) const; };
+struct piece_delete {
+	std::pmr::memory_resource *resource;
+	size_t size;
+	void operator()(piece *) const;
+};
+/* tag for constructing pieces with names which are already validated */
+struct trusted_t { explicit trusted_t() = default; };
+inline constexpr trusted_t trusted{};
+template<class Piece, bool Post> class walker;
+template<class Node> class named_range;
+struct compact_pool;
+struct compact_tables;
+struct frozen_tables;
+template<class Handle> class compact_range;
+class sibling_range;
+/* integral types and non-empty tuple-like types made of cells */
+template<class T>
+consteval bool
+is_cell()
+{
+	if constexpr (std::is_integral_v<T>)
+		return true;
+	else if constexpr (requires { std::tuple_size<T>::value; }) {
+		if constexpr (std::tuple_size_v<T> == 0)
+			return false;
+		else
+			return []<size_t ...I>(std::index_sequence<I...>) {
+				return (is_cell<std::remove_cv_t<
+				    std::tuple_element_t<I, T>>>() && ...);
+			}(std::make_index_sequence<std::tuple_size_v<T>>{});
+	} else
+		return false;
+}
+template<class T> concept cell = is_cell<T>();
+#ifndef __cpp_lib_expected
+template<class T, class E> class expected;
+#endif
+}
+
+/*
+ * errc - error codes returned by try_* functions
+ */
+enum class errc {
+	bad_path = 1,		/* path format is invalid */
+	not_found,		/* path does not exist */
+	not_node,		/* path does not refer to a node */
+	not_property,		/* path does not refer to a property */
+	incompatible_type,	/* property can not be converted to type */
+	ambiguous_path,		/* path matches more than one node */
+	no_index,		/* alias or label index could not be built */
+};
+
+/*
+ * result - value or error code returned by try_* functions
+ */
+#ifdef __cpp_lib_expected
+template<class T> using result = std::expected<T, errc>;
+#else
+template<class T> using result = dtl::expected<T, errc>;
+#endif
 
 /*
  * piece - a piece of the devicetree structure block
@@ -39,6 +125,7 @@ class property;
 class piece {
 public:
 	piece() = default;
+	explicit piece(dtl::tree &);
 	piece(node &parent, std::string_view name);
 
 	piece(piece &&) = delete;
@@ -51,13 +138,18 @@ public:
 	std::optional<std::reference_wrapper<node>> parent();
 	std::optional<std::reference_wrapper<const node>> parent() const;
 
+protected:
+	void modified();
+
 private:
 	virtual bool v_equal(const piece &) const = 0;
 
-	const std::optional<std::reference_wrapper<node>> parent_{std::nullopt};
-	const std::string name_;
+	dtl::tree *const tree_{nullptr};
+	node *const parent_{nullptr};
+	const std::pmr::string name_;
 
 	friend bool operator==(const piece &, const piece &);
+	friend struct dtl::tree;
 };
 
 bool operator==(const piece &, const piece &);
@@ -72,8 +164,14 @@ std::string_view name(const piece &);
 
 /*
  * path(piece &) - get path from root of tree to piece
+ *
+ * The path is built in a single pass once its length is known. The string
+ * overload assigns the path to a reusable string. The buffer overload returns
+ * the length of the path and only writes the path if it fits.
  */
 std::string path(const piece &);
+void path(const piece &, std::string &);
+size_t path(const piece &, std::span<char>);
 
 /*
  * parent(piece &) - get node containing piece
@@ -85,6 +183,8 @@ std::optional<std::reference_wrapper<const node>> parent(const piece &);
 
 /*
  * root(piece &) - get root node of flattened device tree
+ *
+ * This is a constant time operation for pieces of a tree owned by an fdt.
  */
 node &root(piece &);
 const node &root(const piece &);
@@ -113,19 +213,92 @@ public:
 	using container = std::vector<std::byte>;
 
 	property(node &parent, std::string_view name);
+	property(node &parent, std::string_view name, dtl::trusted_t);
 
 	std::span<const std::byte> get() const;
 	void set(container &&);
 	void set(std::span<const std::byte>);
+	void set(const property &);
+
+	/* replace value with uninitialised bytes to be written by caller
+	 * before the value is read */
+	std::span<std::byte> allocate(size_t);
 
 private:
+	friend bool is_string(const property &);
+	friend bool is_stringlist(const property &);
+
 	virtual bool v_equal(const piece &) const override;
+	uint8_t classify() const;
+
+	/* value is immutable and may be shared with cloned properties */
+	std::shared_ptr<const std::byte[]> value_;
+	size_t size_{0};
+
+	/* string classification of value, computed on demand */
+	mutable std::atomic<uint8_t> kind_{0};
+};
 
-	container value_;
+/*
+ * stringlist - view of the strings in a stringlist property
+ *
+ * Strings are split out of the property value as the range is iterated.
+ * Empty strings are skipped unless the range is made with empty::keep.
+ */
+class stringlist {
+public:
+	class iterator;
+
+	enum class empty { skip, keep };
+
+	stringlist() = default;
+	explicit stringlist(std::span<const std::byte>, empty = empty::skip);
+
+	iterator begin() const;
+	iterator end() const;
+
+private:
+	std::span<const std::byte> d_;
+	empty empty_{empty::skip};
+};
+
+class stringlist::iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = std::string_view;
+	using difference_type = std::ptrdiff_t;
+	using reference = std::string_view;
+	using pointer = void;
+
+	iterator() = default;
+	iterator(const char *p, const char *e, bool keep);
+
+	std::string_view operator*() const { return {p_, n_}; }
+	iterator &operator++();
+	iterator operator++(int) { auto t{*this}; ++*this; return t; }
+
+	friend bool operator==(const iterator &l, const iterator &r)
+	{
+		return l.p_ == r.p_;
+	}
+
+private:
+	void settle();
+
+	const char *p_{nullptr};
+	const char *e_{nullptr};
+	size_t n_{0};
+	bool keep_{false};
 };
 
+inline stringlist::iterator begin(const stringlist &l) { return l.begin(); }
+inline stringlist::iterator end(const stringlist &l) { return l.end(); }
+
 /*
  * set(property &, *) - set property value
+ *
+ * set<T> and set_array<T> support the same types as as<T> and as_array<T>
+ * and encode directly into a single allocation of the exact value size.
  */
 void set(property &, uint32_t);
 void set(property &, uint64_t);
@@ -133,6 +306,9 @@ void set(property &, std::string_view);
 void set(property &, const std::vector<std::string_view> &);
 void set(property &, property::container &&);
 void set(property &, std::span<const std::byte>);
+void set(property &, const property &);
+template<dtl::cell T> void set(property &, const T &);
+template<dtl::cell T> void set_array(property &, std::span<const T>);
 
 /*
  * is_*(property &) - test if property value can be converted to type
@@ -156,21 +332,66 @@ template<class T> bool is_array(const property &);
  * Throws std::invalid_argument if the property can not be converted.
  *
  * Strings and bytes are returned as references to the property value.
+ * as_stringlist skips empty strings unless asked to keep them, in which case
+ * its strings match the indices used by stringlist_*.
  *
  * as<T> and as_array<T> support integral types, types for which
  * std::tuple_size is defined and composite types thereof.
  */
 std::string_view as_string(const property &);
-std::vector<std::string_view> as_stringlist(const property &);
+stringlist as_stringlist(const property &,
+			 stringlist::empty = stringlist::empty::skip);
 template<class T> T as(const property &);
 template<class T> auto as_array(const property &);
 std::span<const std::byte> as_bytes(const property &);
 
+/*
+ * stringlist_*(property &) - query stringlist property
+ *
+ * stringlist_count returns the number of strings.
+ * stringlist_index returns the index of a string, if present.
+ * stringlist_at returns the string at an index.
+ *
+ * These do not allocate. Empty strings are counted as for libfdt's
+ * fdt_stringlist_*, so indices match companion properties such as clocks
+ * and clock-names, and as_stringlist(p, stringlist::empty::keep).
+ *
+ * Throws std::invalid_argument if the property is not a stringlist.
+ * stringlist_at throws std::out_of_range if the index is out of range.
+ */
+size_t stringlist_count(const property &);
+std::optional<size_t> stringlist_index(const property &, std::string_view);
+std::string_view stringlist_at(const property &, size_t);
+
+/*
+ * as_be_span<T>(property &) - view property as array of big-endian values
+ * as_array_into<T>(property &, span) - decode array into buffer
+ *
+ * These support the same types as as_array<T>. as_be_span<T> refers to the
+ * property value and decodes on access. as_array_into<T> decodes the whole
+ * property in one pass, using SIMD byte shuffles for integral types where
+ * the CPU supports them, and returns the part of the buffer which was
+ * written.
+ *
+ * Throws std::invalid_argument if the property can not be converted or if
+ * the buffer is too small.
+ */
+template<class T> be_span<T> as_be_span(const property &);
+template<class T> std::span<T> as_array_into(const property &, std::span<T>);
+
+/*
+ * try_as_*(property &) - convert property to type
+ *
+ * As as_*, but returns errc::incompatible_type instead of throwing.
+ */
+result<std::string_view> try_as_string(const property &);
+template<class T> result<T> try_as(const property &);
+
 /*
  * node - a devicetree node
  */
 class node : public piece {
-	using piece_p = std::unique_ptr<piece>;
+	using piece_p = std::unique_ptr<piece, dtl::piece_delete>;
 
 	struct set_compare {
 		using is_transparent = void;
@@ -181,11 +402,14 @@ class node : public piece {
 		bool operator()(const piece_p &, const Key &) const;
 		bool operator()(const piece_p &, const piece_p &) const;
 	};
-	using piece_set = std::set<piece_p, set_compare>;
+	using piece_set = std::pmr::set<piece_p, set_compare>;
 
 public:
 	node() = default;
+	explicit node(dtl::tree &);
 	node(node &parent, std::string_view name);
+	node(node &parent, std::string_view name, dtl::trusted_t);
+	~node() override;
 
 	auto children();
 	auto children() const;
@@ -194,11 +418,25 @@ public:
 	T& add(std::string_view name, A &&...);
 
 private:
+	template<class, bool> friend class dtl::walker;
+	template<class> friend class dtl::named_range;
+	friend class selector;
+	friend std::pmr::memory_resource *resource(const node &);
+
 	virtual bool v_equal(const piece &) const override;
 
 	piece_set children_;
 };
 
+/*
+ * resource - get memory resource used for allocations below node
+ *
+ * Subnodes, properties, names and property values added below a node are
+ * allocated from the resource of the node. A node which does not belong to
+ * an fdt uses the default resource at the time it was constructed.
+ */
+std::pmr::memory_resource *resource(const node &);
+
 /*
  * node_name - get node-name part of node name
  */
@@ -209,6 +447,92 @@ std::string_view node_name(const node &);
  */
 std::optional<std::string_view> unit_address(const node &);
 
+/*
+ * region - address and size of a region in the root address space
+ */
+struct region {
+	uint64_t address;
+	uint64_t size;
+
+	bool operator==(const region &) const = default;
+};
+
+/*
+ * reg - get regions described by reg property of node
+ *
+ * Addresses are decoded using #address-cells and #size-cells of the parent
+ * node and translated through the ranges property of each parent bus into
+ * the root address space. Cells beyond 64 bits are truncated.
+ *
+ * The cell sizes and ranges of each bus are decoded on first use and cached
+ * until the tree is modified.
+ *
+ * The span overload does not allocate. It returns the number of regions and
+ * only writes them if they fit.
+ *
+ * Throws std::invalid_argument if the node has no reg property, a property
+ * is malformed or an address can not be translated.
+ */
+std::vector<region> reg(const node &);
+size_t reg(const node &, std::span<region>);
+
+/*
+ * translate_address - translate bus address into root address space
+ *
+ * The address is in the address space of the children of the bus node.
+ *
+ * Throws std::invalid_argument if the address can not be translated.
+ */
+uint64_t translate_address(const node &bus, uint64_t);
+
+/*
+ * interrupt - interrupt specifier for an interrupt controller
+ */
+struct interrupt {
+	std::reference_wrapper<const node> controller;
+	std::vector<uint32_t> specifier;
+};
+
+/*
+ * interrupts - resolve interrupts of node to interrupt controllers
+ *
+ * Decodes interrupts-extended, or interrupts with the interrupt parent of the
+ * node, and maps each specifier through the interrupt-map of every interrupt
+ * nexus on the way to an interrupt controller.
+ *
+ * Each interrupt-map is parsed once into a hash table of masked child
+ * specifiers and cached with a phandle index until the tree is modified, so
+ * mapping through a nexus is a single hash probe.
+ *
+ * Throws std::invalid_argument if the node does not belong to an fdt, a
+ * property is malformed, a phandle does not exist or an interrupt is not
+ * mapped.
+ */
+std::vector<interrupt> interrupts(const node &);
+
+/*
+ * map_interrupt - resolve interrupt of a child of an interrupt parent
+ *
+ * address is the unit address of the child on the bus of the interrupt
+ * parent. This can be used to route interrupts of devices which are not
+ * described by the tree such as PCI devices, see pci_swizzle.
+ *
+ * Throws as interrupts.
+ */
+interrupt map_interrupt(const node &parent, std::span<const uint32_t> address,
+			std::span<const uint32_t> specifier);
+
+/*
+ * pci_swizzle - get INTx pin on bridge for pin of device in slot
+ *
+ * Pins are numbered from 1 (INTA) to 4 (INTD).
+ */
+constexpr uint32_t
+pci_swizzle(uint32_t slot, uint32_t pin)
+{
+	return (pin - 1 + slot) % 4 + 1;
+}
+
 /*
  * children - get node children
  *
@@ -233,6 +557,124 @@ auto properties(Node &);
 template<class Node>
 auto subnodes(Node &);
 
+/*
+ * subnodes(node &, name) - get subnodes by node-name
+ *
+ * Returns an iterable range of references to the subnodes with node-name
+ * name, i.e. the subnode called name followed by the subnodes called
+ * name@unit-address in name order. Lookup takes O(log n) time as the subnodes
+ * are found by searching the sorted children of the node.
+ *
+ * Adding or removing pieces invalidates iterators.
+ */
+template<class Node>
+auto subnodes(Node &, std::string_view name);
+
+/*
+ * visit - piece visited by a traversal and its depth below the start node
+ */
+template<class Piece>
+struct visit {
+	Piece &piece;
+	size_t depth;
+};
+
+/*
+ * preorder - traverse node and all pieces below it, parents first
+ * postorder - traverse node and all pieces below it, parents last
+ *
+ * Returns an iterable range of visit. The properties of a node are visited
+ * before its subnodes, matching the order of the flattened devicetree
+ * structure block. The start node is visited at depth 0.
+ *
+ * The traversal keeps its own stack so tree depth is not limited by the call
+ * stack. Calling skip() on a preorder iterator prevents the next increment
+ * from descending into the children of the current node.
+ *
+ * Adding or removing pieces invalidates iterators.
+ */
+template<class Node>
+auto preorder(Node &);
+
+template<class Node>
+auto postorder(Node &);
+
+/*
+ * parallel_for_each_node - call fn for node and all nodes below it in parallel
+ *
+ * Subtrees are processed by a pool of threads, by default one per hardware
+ * thread, which share work in batches and sleep while idle. Fewer threads
+ * are used if some can not be started. fn is called exactly once for each
+ * node, in no particular order and from any thread, so it must be safe to
+ * call concurrently.
+ *
+ * If fn throws, remaining nodes may be skipped and the first exception is
+ * rethrown once all threads have stopped.
+ */
+void parallel_for_each_node(const node &,
+			    const std::function<void(const node &)> &fn,
+			    unsigned threads = 0);
+
+/*
+ * binding - description of how to fill a struct from node properties
+ *
+ * A binding is a list of fields, each naming a property and the member of S
+ * it fills:
+ *
+ *	const fdt::binding<uart> b{
+ *		fdt::required_field("clock-frequency", &uart::clock),
+ *		fdt::field("current-speed", &uart::speed),
+ *		fdt::field("dma-coherent", &uart::coherent),
+ *	};
+ *
+ * Members of integral and tuple types are converted as as<T>, string_view
+ * and string members as as_string and vector members as as_array. bool
+ * members are set to whether the property exists and optional members are
+ * reset if it does not. Other members keep their value if the property does
+ * not exist, so defaults can be set before binding.
+ *
+ * Throws std::invalid_argument if two fields name the same property.
+ */
+template<class S>
+class binding {
+public:
+	struct member {
+		std::string name;
+		bool required;
+		std::function<void(S &, const property &)> set;
+		std::function<void(S &)> reset;
+	};
+
+	binding(std::initializer_list<member>);
+
+private:
+	template<class T>
+	friend void bind(const node &, const binding<T> &, T &);
+
+	std::vector<member> members_;
+};
+
+/*
+ * field - bind property to member
+ * required_field - bind property to member, failing if it does not exist
+ */
+template<class S, class M>
+typename binding<S>::member field(std::string_view name, M S::*);
+
+template<class S, class M>
+typename binding<S>::member required_field(std::string_view name, M S::*);
+
+/*
+ * bind - fill struct from node properties
+ *
+ * The struct is filled in one pass over the sorted properties of the node.
+ *
+ * Throws std::invalid_argument if a property can not be converted or a
+ * required property does not exist.
+ */
+template<class S>
+void bind(const node &, const binding<S> &, S &);
+
 /*
  * add_node - add a subnode to a node
  *
@@ -254,16 +696,18 @@ property& add_property(node &, std::string_view name, T &&...value);
  *
  * This function takes a path relative to the node.
  *
- * Throws std::invalid_argument if the path format is invalid.
+ * Throws std::invalid_argument if the path format is invalid or ambiguous.
  */
 bool contains(const node &, std::string_view path);
 
 /*
  * find - find child of node by path
  *
- * This function takes a path relative to the node.
+ * This function takes a path relative to the node. The unit address may be
+ * omitted from a node name if only one subnode has that node-name; a child
+ * whose name matches exactly is always preferred.
  *
- * Throws std::invalid_argument if the path format is invalid.
+ * Throws std::invalid_argument if the path format is invalid or ambiguous.
  */
 std::optional<std::reference_wrapper<const piece>>
 find(const node &, std::string_view path);
@@ -275,18 +719,42 @@ find(node &, std::string_view path);
  * get_node - get a node by path
  *
  * Throws
- *	std::invalid_argument if the path format is invalid.
+ *	std::invalid_argument if the path format is invalid or ambiguous.
  *	std::bad_optional_access if the path does not exist.
  *	std::bad_cast if the path does not refer to a node.
  */
 node& get_node(node &, std::string_view path);
 const node& get_node(const node &, std::string_view path);
 
+/*
+ * try_* - find a piece, node or property by path
+ *
+ * As find, get_node and get_property, but failures are returned as an error
+ * code instead of being thrown. These never throw or allocate.
+ */
+result<std::reference_wrapper<const piece>>
+try_find(const node &, std::string_view path);
+
+result<std::reference_wrapper<piece>>
+try_find(node &, std::string_view path);
+
+result<std::reference_wrapper<const node>>
+try_get_node(const node &, std::string_view path);
+
+result<std::reference_wrapper<node>>
+try_get_node(node &, std::string_view path);
+
+result<std::reference_wrapper<const property>>
+try_get_property(const node &, std::string_view path);
+
+result<std::reference_wrapper<property>>
+try_get_property(node &, std::string_view path);
+
 /*
  * get_property - get a property by path
  *
  * Throws
- *	std::invalid_argument if the path format is invalid.
+ *	std::invalid_argument if the path format is invalid or ambiguous.
  *	std::bad_optional_access if the path does not exist.
  *	std::bad_cast if the path does not refer to a property.
  */
@@ -294,113 +762,818 @@ property& get_property(node &, std::string_view path);
 const property& get_property(const node &, std::string_view path);
 
 /*
- * fdt
+ * selector - compiled query matching pieces of a tree
+ *
+ * A selector is a path where each component is a glob pattern. '*' matches
+ * any run of characters and '?' matches any single character, so "cpu@*"
+ * matches every unit address. An empty component ("//") matches any number
+ * of nodes, so "//ethernet@*" matches ethernet nodes anywhere in the tree.
+ *
+ * Node components may be followed by predicates. "[prop]" requires that the
+ * node has a property and "[prop=\"value\"]" requires that the property is a
+ * string or stringlist containing value.
+ *
+ * The last component matches properties and nodes, other components match
+ * nodes. Components with a literal prefix only visit children with that
+ * prefix.
+ *
+ * Selectors are immutable once compiled and may be used with many trees.
+ *
+ * Throws std::invalid_argument if the selector format is invalid.
  */
-class fdt {
+class selector {
 public:
-	fdt();
+	explicit selector(std::string_view);
 
-	fdt(fdt &&) = default;
-	fdt(const fdt &) = delete;
-	fdt &operator=(fdt &&) = default;
-	fdt &operator=(const fdt &) = delete;
-	~fdt() = default;
+private:
+	friend std::vector<std::reference_wrapper<piece>>
+	select(node &, const selector &);
+	friend std::vector<std::reference_wrapper<const piece>>
+	select(const node &, const selector &);
+
+	struct predicate {
+		std::string property;
+		std::optional<std::string> value;
+	};
 
-	/* TODO(incomplete): memory reservation block */
-	/* TODO(incomplete): boot cpuid */
+	struct step {
+		bool descendant{false};
+		std::string pattern;
+		size_t prefix{0};	/* length of literal prefix */
+		std::vector<predicate> predicates;
+	};
 
-	node& root();
-	const node& root() const;
+	template<class Piece, class Node>
+	std::vector<std::reference_wrapper<Piece>> select(Node &) const;
+	static bool matches(const step &, const piece &);
 
-private:
-	std::unique_ptr<node> root_;
+	std::vector<step> steps_;
 };
 
-bool operator==(const fdt &, const fdt &);
-
-/*
- * root(fdt &) - get root node of flattened device tree
- */
-node& root(fdt &);
-const node& root(const fdt &);
-
 /*
- * load - load a flattened devicetree blob
- * load_keep - load a flattened devicetree blob and return loaded bytes
+ * select - find pieces matching selector
  *
- * Throws exceptions.
+ * The selector is relative to the node. Each matching piece is returned
+ * once, in the order visited by preorder.
  */
-fdt load(std::span<const std::byte>);
-fdt load(int fd);
-fdt load(const std::filesystem::path &);
-std::pair<fdt, std::vector<std::byte>> load_keep(int fd);
-std::pair<fdt, std::vector<std::byte>> load_keep(const std::filesystem::path &);
+std::vector<std::reference_wrapper<piece>> select(node &, const selector &);
+std::vector<std::reference_wrapper<const piece>>
+select(const node &, const selector &);
 
 /*
- * save - save a flattened devicetree blob
+ * path_handle - precompiled path for repeated lookups
  *
- * Throws exceptions.
- */
-std::vector<std::byte> save(const fdt &);
-
-/*
- * contains - test if fdt contains path
+ * The path is split into components once. The piece found by the last
+ * lookup is remembered along with the generation of its tree, so finding the
+ * handle again from the same start in an unmodified tree takes O(1) time.
+ * Modifying the tree causes the next lookup to resolve the path again.
+ *
+ * The cache is locked while it is read or updated, so a path_handle may be
+ * used by multiple threads concurrently for lookups in unmodified trees.
  *
  * Throws std::invalid_argument if the path format is invalid.
  */
-bool contains(const fdt &, std::string_view path);
+class path_handle {
+public:
+	explicit path_handle(std::string_view path);
+	path_handle(const path_handle &);
+	path_handle &operator=(const path_handle &);
+
+private:
+	friend std::optional<std::reference_wrapper<const piece>>
+	find(const node &, const path_handle &);
+	friend std::optional<std::reference_wrapper<piece>>
+	find(node &, const path_handle &);
+	friend std::optional<std::reference_wrapper<const piece>>
+	find(const fdt &, const path_handle &);
+	friend std::optional<std::reference_wrapper<piece>>
+	find(fdt &, const path_handle &);
+
+	result<std::reference_wrapper<piece>> resolve(const node &, bool) const;
+	result<std::reference_wrapper<piece>> walk(const node &, bool) const;
+
+	bool absolute_;
+	std::vector<std::string> components_;
+
+	/* result of last lookup */
+	struct cache {
+		const node *start{nullptr};
+		bool fdt{false};
+		uint64_t generation{0};
+		piece *found{nullptr};
+		errc error{};
+	};
+	mutable std::mutex lock_;
+	mutable cache cache_;
+};
 
 /*
- * find - find piece of fdt by path
+ * find(node &, path_handle) - find child of node by precompiled path
  *
- * Throws std::invalid_argument if the path format is invalid.
+ * As find(node &, path), the path must be relative.
  */
 std::optional<std::reference_wrapper<const piece>>
-find(const fdt &, std::string_view path);
-
+find(const node &, const path_handle &);
 std::optional<std::reference_wrapper<piece>>
-find(fdt &, std::string_view path);
+find(node &, const path_handle &);
+
+namespace dtl {
 
 /*
- * get_node - get a node by path
+ * name_chars - table of characters allowed in node and property names
  *
- * Throws
- *	std::invalid_argument if the path format is invalid.
- *	std::bad_optional_access if the path does not exist.
- *	std::bad_cast if the path does not refer to a node.
+ * See tables 2.1 and 2.2 in the devicetree specification.
  */
-node& get_node(fdt &, std::string_view path);
-const node& get_node(const fdt &, std::string_view path);
+enum : uint8_t {
+	node_char = 1,
+	property_char = 2,
+};
+
+inline constexpr auto name_chars{[] {
+	std::array<uint8_t, 256> t{};
+	auto allow = [&](unsigned char lo, unsigned char hi) {
+		for (auto c{lo}; c <= hi; ++c)
+			t[c] = node_char | property_char;
+	};
+	allow('0', '9');
+	allow('a', 'z');
+	allow('A', 'Z');
+	for (auto c : {',', '.', '_', '+', '-'})
+		t[static_cast<unsigned char>(c)] = node_char | property_char;
+	for (auto c : {'?', '#'})
+		t[static_cast<unsigned char>(c)] = property_char;
+	return t;
+}()};
 
 /*
- * get_property - get a property by path
+ * valid_path_component - test if path component can name a piece
  *
- * Throws
- *	std::invalid_argument if the path format is invalid.
- *	std::bad_optional_access if the path does not exist.
- *	std::bad_cast if the path does not refer to a property.
+ * The first component of a relative path may be a label reference. Names
+ * are limited to 31 characters, excluding any unit address, as they are by
+ * the node and property constructors.
  */
-property& get_property(fdt &, std::string_view path);
-const property& get_property(const fdt &, std::string_view path);
+constexpr bool
+valid_path_component(std::string_view c, bool first)
+{
+	auto valid = [](std::string_view s, uint8_t kind, size_t max) {
+		return !empty(s) && size(s) <= max &&
+		       std::all_of(begin(s), end(s), [&](char ch) {
+			return name_chars[static_cast<unsigned char>(ch)] & kind;
+		});
+	};
+	constexpr size_t max_name{31};
+	if (first && c.starts_with('&'))
+		c.remove_prefix(1);
+	const auto at{c.find('@')};
+	if (at == std::string_view::npos)
+		return valid(c, node_char | property_char, max_name);
+	return valid(c.substr(0, at), node_char, max_name) &&
+	       valid(c.substr(at + 1), node_char, std::string_view::npos);
+}
+
+}
 
 /*
- * implementation details
+ * path_literal - path split and validated at compile time
+ *
+ * Usually created with the _fdtpath literal, e.g. "/chosen/bootargs"_fdtpath.
+ * Components must be node or property names, a node name may omit its unit
+ * address, and a relative path used with an fdt may start with an alias or
+ * "&label". An invalid path fails to compile, so lookups only search for
+ * each component.
+ *
+ * The components refer to the string used to create the path_literal, which
+ * must have static storage duration.
  */
-namespace dtl {
+class path_literal {
+public:
+	static constexpr size_t max_depth{16};
 
-template<class...> inline constexpr bool false_v = false;
+	consteval path_literal(std::string_view);
 
-template<typename T>
-constexpr size_t
-byte_size()
-{
-	if constexpr (std::is_integral_v<T>)
-		return sizeof(T);
-	else {
-		/* REVISIT: can we do this without constructing a T? */
-		return std::apply([](const auto &...v) {
-			return (byte_size<std::decay_t<decltype(v)>>() + ...);
-		}, T{});
+	constexpr bool absolute() const { return absolute_; }
+	constexpr std::span<const std::string_view> components() const
+	{
+		return {data(components_), size_};
+	}
+
+private:
+	bool absolute_;
+	size_t size_{0};
+	std::array<std::string_view, max_depth> components_{};
+};
+
+consteval
+path_literal::path_literal(std::string_view p)
+: absolute_{p.starts_with('/')}
+{
+	if (absolute_)
+		p.remove_prefix(1);
+	for (;;) {
+		const auto sep{p.find('/')};
+		const auto c{p.substr(0, sep)};
+		if (!dtl::valid_path_component(c, !absolute_ && !size_))
+			throw std::invalid_argument{"bad path"};
+		if (size_ == max_depth)
+			throw std::invalid_argument{"path too deep"};
+		components_[size_++] = c;
+		if (sep == std::string_view::npos)
+			break;
+		p.remove_prefix(sep + 1);
+	}
+}
+
+inline namespace literals {
+
+consteval path_literal
+operator""_fdtpath(const char *s, size_t n)
+{
+	return path_literal{std::string_view{s, n}};
+}
+
+}
+
+/*
+ * find, get_node, get_property(node &, path_literal) - look up compiled path
+ *
+ * As the versions taking a string path, which must be relative.
+ */
+std::optional<std::reference_wrapper<const piece>>
+find(const node &, const path_literal &);
+std::optional<std::reference_wrapper<piece>> find(node &, const path_literal &);
+node& get_node(node &, const path_literal &);
+const node& get_node(const node &, const path_literal &);
+property& get_property(node &, const path_literal &);
+const property& get_property(const node &, const path_literal &);
+
+/*
+ * fdt - a flattened device tree
+ *
+ * A const fdt may be read by any number of threads concurrently. Lookup
+ * caches are built under a lock. Modifying an fdt must not be concurrent
+ * with any other access to it.
+ */
+class fdt {
+public:
+	fdt();
+	explicit fdt(std::pmr::memory_resource *);
+
+	fdt(fdt &&);
+	fdt(const fdt &) = delete;
+	fdt &operator=(fdt &&);
+	fdt &operator=(const fdt &) = delete;
+	~fdt();
+
+	/* TODO(incomplete): memory reservation block */
+	/* TODO(incomplete): boot cpuid */
+
+	node& root();
+	const node& root() const;
+
+private:
+	std::unique_ptr<dtl::tree, dtl::tree_delete> tree_;
+};
+
+bool operator==(const fdt &, const fdt &);
+
+/*
+ * resource - get memory resource used for allocations by fdt
+ *
+ * An fdt constructed with a memory resource makes all of its allocations
+ * there, including its lookup caches. The resource must outlive the fdt.
+ */
+std::pmr::memory_resource *resource(const fdt &);
+
+/*
+ * clone - make a copy of a flattened device tree
+ *
+ * If the copy uses the same memory resource as the original, property values
+ * are shared between them until either is modified, so cloning costs one
+ * allocation per node and property name regardless of the size of the
+ * values. A copy made with a different resource copies the values into it,
+ * so it remains valid after the original and its resource are gone.
+ */
+fdt clone(const fdt &);
+fdt clone(const fdt &, std::pmr::memory_resource *);
+
+/*
+ * apply_overlay - apply a devicetree overlay to a flattened device tree
+ *
+ * The overlay must be compiled with symbols (dtc -@). Phandles in the overlay
+ * are moved clear of the phandles in the tree, references to labels in the
+ * tree are resolved using its __symbols__ node, fragments are merged into
+ * their targets and overlay labels are added to the __symbols__ node.
+ *
+ * The overlay itself is not modified.
+ *
+ * Throws std::invalid_argument if the overlay is malformed or refers to a
+ * label or target which does not exist in the tree.
+ */
+void apply_overlay(fdt &, const fdt &overlay);
+
+/*
+ * root(fdt &) - get root node of flattened device tree
+ */
+node& root(fdt &);
+const node& root(const fdt &);
+
+/*
+ * load - load a flattened devicetree blob
+ * load_keep - load a flattened devicetree blob and return loaded bytes
+ *
+ * Node and property names are validated as by add_node and add_property,
+ * since fdt_check_full does not check their characters or length. Each name
+ * in the strings block is checked once however many properties use it.
+ *
+ * load allocates the tree, and any buffer used to read the blob, from the
+ * memory resource. Reading from a path also uses a file stream buffer from
+ * the global heap.
+ *
+ * Throws exceptions.
+ */
+fdt load(std::span<const std::byte>,
+	 std::pmr::memory_resource * = std::pmr::get_default_resource());
+fdt load(int fd,
+	 std::pmr::memory_resource * = std::pmr::get_default_resource());
+fdt load(const std::filesystem::path &,
+	 std::pmr::memory_resource * = std::pmr::get_default_resource());
+std::pair<fdt, std::vector<std::byte>> load_keep(int fd);
+std::pair<fdt, std::vector<std::byte>> load_keep(const std::filesystem::path &);
+
+/*
+ * save - save a flattened devicetree blob
+ *
+ * Throws exceptions.
+ */
+std::vector<std::byte> save(const fdt &);
+
+/*
+ * find_alias - find node referenced by an alias in /aliases
+ * find_label - find node referenced by a label in /__symbols__
+ *
+ * The alias and label indexes are built on first use and rebuilt on the next
+ * lookup after the tree is modified, so a lookup is a single hash probe.
+ */
+std::optional<std::reference_wrapper<const node>>
+find_alias(const fdt &, std::string_view alias);
+
+std::optional<std::reference_wrapper<node>>
+find_alias(fdt &, std::string_view alias);
+
+std::optional<std::reference_wrapper<const node>>
+find_label(const fdt &, std::string_view label);
+
+std::optional<std::reference_wrapper<node>>
+find_label(fdt &, std::string_view label);
+
+/*
+ * find_phandle - find node by phandle
+ *
+ * The phandle index is built on first use and rebuilt on the next lookup
+ * after the tree is modified.
+ */
+std::optional<std::reference_wrapper<const node>>
+find_phandle(const fdt &, uint32_t phandle);
+
+std::optional<std::reference_wrapper<node>>
+find_phandle(fdt &, uint32_t phandle);
+
+/*
+ * parallel_for_each_node - call fn for all nodes in fdt in parallel
+ *
+ * See parallel_for_each_node(const node &, ...).
+ */
+void parallel_for_each_node(const fdt &,
+			    const std::function<void(const node &)> &fn,
+			    unsigned threads = 0);
+
+/*
+ * contains - test if fdt contains path
+ *
+ * Throws std::invalid_argument if the path format is invalid or ambiguous.
+ */
+bool contains(const fdt &, std::string_view path);
+
+/*
+ * find - find piece of fdt by path
+ *
+ * Paths are absolute ("/soc/serial"), or start with an alias ("serial0/dma")
+ * or a label ("&uart0/dma") which is resolved using find_alias or find_label.
+ *
+ * An alias or label which does not exist is not found, as for a missing node.
+ *
+ * Throws std::invalid_argument if the path format is invalid or ambiguous.
+ */
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &, std::string_view path);
+
+std::optional<std::reference_wrapper<piece>>
+find(fdt &, std::string_view path);
+
+/*
+ * get_node - get a node by path
+ *
+ * Throws
+ *	std::invalid_argument if the path format is invalid or ambiguous.
+ *	std::bad_optional_access if the path does not exist.
+ *	std::bad_cast if the path does not refer to a node.
+ */
+node& get_node(fdt &, std::string_view path);
+const node& get_node(const fdt &, std::string_view path);
+
+/*
+ * try_* - find a piece, node or property by path
+ *
+ * As find, get_node and get_property, but failures are returned as an error
+ * code instead of being thrown. These never throw.
+ *
+ * The alias and label indexes are rebuilt on the first lookup through an
+ * alias or label after the tree has been modified. If the rebuild fails the
+ * error is no_index. Lookups which do not need a rebuild never allocate.
+ */
+result<std::reference_wrapper<const piece>>
+try_find(const fdt &, std::string_view path);
+
+result<std::reference_wrapper<piece>>
+try_find(fdt &, std::string_view path);
+
+result<std::reference_wrapper<const node>>
+try_get_node(const fdt &, std::string_view path);
+
+result<std::reference_wrapper<node>>
+try_get_node(fdt &, std::string_view path);
+
+result<std::reference_wrapper<const property>>
+try_get_property(const fdt &, std::string_view path);
+
+result<std::reference_wrapper<property>>
+try_get_property(fdt &, std::string_view path);
+
+/*
+ * get_property - get a property by path
+ *
+ * Throws
+ *	std::invalid_argument if the path format is invalid or ambiguous.
+ *	std::bad_optional_access if the path does not exist.
+ *	std::bad_cast if the path does not refer to a property.
+ */
+property& get_property(fdt &, std::string_view path);
+const property& get_property(const fdt &, std::string_view path);
+
+/*
+ * find(fdt &, path_handle) - find piece of fdt by precompiled path
+ *
+ * As find(fdt &, path).
+ */
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &, const path_handle &);
+std::optional<std::reference_wrapper<piece>>
+find(fdt &, const path_handle &);
+
+/*
+ * find, get_node, get_property(fdt &, path_literal) - look up compiled path
+ *
+ * As the versions taking a string path.
+ */
+std::optional<std::reference_wrapper<const piece>>
+find(const fdt &, const path_literal &);
+std::optional<std::reference_wrapper<piece>> find(fdt &, const path_literal &);
+node& get_node(fdt &, const path_literal &);
+const node& get_node(const fdt &, const path_literal &);
+property& get_property(fdt &, const path_literal &);
+const property& get_property(const fdt &, const path_literal &);
+
+/*
+ * select - find pieces matching selector
+ *
+ * The selector is relative to the root node.
+ */
+std::vector<std::reference_wrapper<piece>> select(fdt &, const selector &);
+std::vector<std::reference_wrapper<const piece>>
+select(const fdt &, const selector &);
+
+/*
+ * static_node, static_property - read-only devicetree in constant data
+ *
+ * Static trees are generated from a devicetree blob at build time by fdtgen,
+ * which writes a header of constexpr tables. The subnodes and properties of
+ * each node are sorted by name. reg holds the regions of the reg property
+ * translated to the root address space, or is empty if the node has no reg
+ * or its addresses can not be translated. compatible holds the strings of
+ * the compatible property.
+ *
+ * The functions below mirror those for node and are constexpr, so lookups
+ * with constant arguments are evaluated at compile time and a bad path in a
+ * constant expression does not compile.
+ */
+struct static_property {
+	std::string_view name;
+	std::string_view value;		/* raw bytes */
+};
+
+struct static_node {
+	std::string_view name;
+	const static_node *parent;
+	std::span<const static_node> subnodes;
+	std::span<const static_property> properties;
+	std::span<const region> reg;
+	std::span<const std::string_view> compatible;
+};
+
+constexpr std::string_view name(const static_node &);
+constexpr std::string_view name(const static_property &);
+constexpr std::optional<std::reference_wrapper<const static_node>>
+parent(const static_node &);
+constexpr std::span<const static_node> subnodes(const static_node &);
+constexpr std::span<const static_property> properties(const static_node &);
+constexpr std::span<const region> reg(const static_node &);
+constexpr bool is_compatible(const static_node &, std::string_view);
+
+std::span<const std::byte> as_bytes(const static_property &);
+constexpr std::string_view as_string(const static_property &);
+template<class T> constexpr T as(const static_property &);
+
+/*
+ * try_get_*, get_*(static_node &, path) - look up static node by path
+ *
+ * Paths are relative and node names may omit the unit address as for
+ * find(node &, path).
+ *
+ * get_* throw:
+ *	std::invalid_argument if the path format is invalid or ambiguous.
+ *	std::bad_optional_access if the path does not exist.
+ */
+constexpr result<std::reference_wrapper<const static_node>>
+try_get_node(const static_node &, std::string_view path);
+constexpr result<std::reference_wrapper<const static_property>>
+try_get_property(const static_node &, std::string_view path);
+constexpr const static_node& get_node(const static_node &, std::string_view path);
+constexpr const static_property&
+get_property(const static_node &, std::string_view path);
+
+namespace dtl {
+struct static_sizes {
+	size_t size;
+	size_t nodes;
+	size_t properties;
+	size_t regions;
+	size_t strings;
+};
+template<static_sizes> class static_tree;
+template<class B> constexpr static_sizes static_sizes_of(const B &);
+}
+
+/*
+ * static_fdt - devicetree blob parsed at compile time
+ *
+ * Parses a blob held in a constexpr array of char, unsigned char or
+ * std::byte, such as one included with #embed or generated by xxd -i, into
+ * static_node tables equivalent to those written by fdtgen:
+ *
+ *	static constexpr unsigned char blob[]{
+ *	#embed "board.dtb"
+ *	};
+ *	constexpr auto &mem{get_property(root(fdt::static_fdt<blob>), "memory/reg")};
+ *
+ * A malformed blob fails to compile.
+ */
+template<const auto &Blob>
+inline constexpr dtl::static_tree<dtl::static_sizes_of(Blob)> static_fdt{Blob};
+
+/*
+ * compact_fdt - read-only devicetree in flat tables
+ *
+ * Nodes and properties are records in two tables addressed by 32-bit
+ * indices. Names are offsets into a single table of unique strings and
+ * values are ranges of a single byte pool, so a node record is 16 bytes and
+ * a property record 8 bytes whatever the pointer size. Nodes are breadth
+ * first so the subnodes of a node are contiguous, and subnodes and
+ * properties are sorted by name.
+ *
+ * compact_node and compact_property are handles to records, valid for the
+ * lifetime of the compact_fdt. The functions below mirror those for node.
+ */
+struct compact_node {
+	const dtl::compact_tables *tables;
+	uint32_t index;
+
+	friend bool operator==(const compact_node &,
+			       const compact_node &) = default;
+};
+
+struct compact_property {
+	const dtl::compact_pool *tables;
+	uint32_t index;
+
+	friend bool operator==(const compact_property &,
+			       const compact_property &) = default;
+};
+
+class compact_fdt {
+public:
+	compact_fdt(compact_fdt &&);
+	compact_fdt(const compact_fdt &) = delete;
+	compact_fdt &operator=(compact_fdt &&);
+	compact_fdt &operator=(const compact_fdt &) = delete;
+	~compact_fdt();
+
+	compact_node root() const;
+
+	/* bytes used by the tables */
+	size_t size() const;
+
+private:
+	explicit compact_fdt(std::unique_ptr<dtl::compact_tables>);
+
+	std::unique_ptr<dtl::compact_tables> tables_;
+
+	friend compact_fdt compact(const fdt &);
+	friend compact_fdt load_compact(std::span<const std::byte>);
+};
+
+/*
+ * compact - convert flattened device tree into compact tables
+ * load_compact - load a flattened devicetree blob into compact tables
+ *
+ * load_compact builds the tables directly from the blob without a mutable
+ * tree in between, so its peak memory use is the blob, the tables, an index
+ * of unique names and a queue of nodes waiting to be visited.
+ *
+ * Throws std::invalid_argument if the blob is malformed or too large to
+ * index with 32 bits.
+ */
+compact_fdt compact(const fdt &);
+compact_fdt load_compact(std::span<const std::byte>);
+
+compact_node root(const compact_fdt &);
+std::string_view name(compact_node);
+std::string_view name(compact_property);
+std::optional<compact_node> parent(compact_node);
+dtl::compact_range<compact_node> subnodes(compact_node);
+dtl::compact_range<compact_property> properties(compact_node);
+std::vector<region> reg(compact_node);
+bool is_compatible(compact_node, std::string_view);
+
+std::span<const std::byte> as_bytes(compact_property);
+std::string_view as_string(compact_property);
+template<class T> T as(compact_property);
+
+/*
+ * try_get_*, get_*(compact_node &, path) - look up compact node by path
+ *
+ * As for try_get_*, get_*(static_node &, path).
+ */
+result<compact_node> try_get_node(compact_node, std::string_view path);
+result<compact_property>
+try_get_property(compact_node, std::string_view path);
+compact_node get_node(compact_node, std::string_view path);
+compact_property get_property(compact_node, std::string_view path);
+
+/*
+ * frozen_fdt - immutable devicetree in a pre-order table
+ *
+ * Node records are in pre-order, so the subtree of a node is the contiguous
+ * run of records from the node to its subtree end index and a scan of the
+ * whole tree is a linear sweep of one array. Each node record also holds the
+ * index of its first property; property records, names and values are
+ * stored as for compact_fdt, so the properties of a frozen node are
+ * compact_property handles.
+ *
+ * frozen_node is a handle to a record, valid for the lifetime of the
+ * frozen_fdt. The functions below mirror those for node.
+ */
+struct frozen_node {
+	const dtl::frozen_tables *tables;
+	uint32_t index;
+
+	friend bool operator==(const frozen_node &,
+			       const frozen_node &) = default;
+};
+
+class frozen_fdt {
+public:
+	frozen_fdt(frozen_fdt &&);
+	frozen_fdt(const frozen_fdt &) = delete;
+	frozen_fdt &operator=(frozen_fdt &&);
+	frozen_fdt &operator=(const frozen_fdt &) = delete;
+	~frozen_fdt();
+
+	frozen_node root() const;
+
+	/* bytes used by the tables */
+	size_t size() const;
+
+private:
+	explicit frozen_fdt(std::unique_ptr<dtl::frozen_tables>);
+
+	std::unique_ptr<dtl::frozen_tables> tables_;
+
+	friend frozen_fdt freeze(const fdt &);
+};
+
+/*
+ * freeze - convert flattened device tree into a frozen pre-order table
+ * unfreeze - convert frozen table back into a mutable flattened device tree
+ *
+ * freeze throws std::invalid_argument if the tree is too large to index with
+ * 32 bits. unfreeze allocates the new tree from the memory resource.
+ */
+frozen_fdt freeze(const fdt &);
+fdt unfreeze(const frozen_fdt &,
+	     std::pmr::memory_resource * = std::pmr::get_default_resource());
+
+frozen_node root(const frozen_fdt &);
+std::string_view name(frozen_node);
+std::optional<frozen_node> parent(frozen_node);
+dtl::sibling_range subnodes(frozen_node);
+dtl::compact_range<compact_property> properties(frozen_node);
+std::vector<region> reg(frozen_node);
+bool is_compatible(frozen_node, std::string_view);
+
+/*
+ * subtree - get node and all nodes below it in pre-order
+ */
+dtl::compact_range<frozen_node> subtree(frozen_node);
+
+/*
+ * try_get_*, get_*(frozen_node &, path) - look up frozen node by path
+ *
+ * As for try_get_*, get_*(static_node &, path).
+ */
+result<frozen_node> try_get_node(frozen_node, std::string_view path);
+result<compact_property>
+try_get_property(frozen_node, std::string_view path);
+frozen_node get_node(frozen_node, std::string_view path);
+compact_property get_property(frozen_node, std::string_view path);
+
+/*
+ * implementation details
+ */
+namespace dtl {
+
+template<class...> inline constexpr bool false_v = false;
+
+#ifdef __cpp_lib_expected
+constexpr auto
+fail(errc e)
+{
+	return std::unexpected{e};
+}
+#else
+template<class E>
+struct unexpected {
+	E error;
+};
+
+constexpr auto
+fail(errc e)
+{
+	return unexpected<errc>{e};
+}
+
+/*
+ * expected - minimal subset of std::expected
+ */
+template<class T, class E>
+class expected {
+public:
+	using value_type = T;
+	using error_type = E;
+
+	constexpr expected(const T &v) : v_{std::in_place_index<0>, v} { }
+	constexpr expected(T &&v) : v_{std::in_place_index<0>, std::move(v)} { }
+	constexpr expected(unexpected<E> e) : v_{std::in_place_index<1>, e.error} { }
+
+	constexpr bool has_value() const { return v_.index() == 0; }
+	constexpr explicit operator bool() const { return has_value(); }
+
+	constexpr T &value() & { return std::get<0>(v_); }
+	constexpr const T &value() const & { return std::get<0>(v_); }
+	constexpr T &&value() && { return std::get<0>(std::move(v_)); }
+	constexpr E error() const { return *std::get_if<1>(&v_); }
+
+	constexpr T &operator*() & { return *std::get_if<0>(&v_); }
+	constexpr const T &operator*() const & { return *std::get_if<0>(&v_); }
+	constexpr T &&operator*() && { return std::move(*std::get_if<0>(&v_)); }
+	constexpr T *operator->() { return std::get_if<0>(&v_); }
+	constexpr const T *operator->() const { return std::get_if<0>(&v_); }
+
+private:
+	std::variant<T, E> v_;
+};
+#endif
+
+template<typename T>
+constexpr size_t
+byte_size()
+{
+	if constexpr (std::is_integral_v<T>)
+		return sizeof(T);
+	else {
+		/* REVISIT: can we do this without constructing a T? */
+		return std::apply([](const auto &...v) {
+			return (byte_size<std::decay_t<decltype(v)>>() + ...);
+		}, T{});
 	}
 }
 
@@ -432,77 +1605,500 @@ byteswap(T v)
 }
 
 template<typename T>
-T
+constexpr T
 read_advance(std::span<const std::byte> &d)
 {
 	assert(d.size() >= byte_size<T>());
 	T t;
 	if constexpr (std::is_integral_v<T>) {
-		std::copy_n(data(d), sizeof(T), reinterpret_cast<std::byte *>(&t));
-		t = byteswap(t);
+		if (std::is_constant_evaluated()) {
+			uint64_t v{0};
+			for (size_t i{0}; i != sizeof(T); ++i)
+				v = v << 8 | std::to_integer<uint64_t>(d[i]);
+			t = static_cast<T>(v);
+		} else {
+			std::copy_n(data(d), sizeof(T),
+				    reinterpret_cast<std::byte *>(&t));
+			t = byteswap(t);
+		}
 		d = d.subspan(sizeof(t));
 	} else {
 		std::apply([&d](auto &...v) {
 			((v = read_advance<std::decay_t<decltype(v)>>(d)), ...);
 		}, t);
 	}
-	return t;
-}
+	return t;
+}
+
+template<typename T>
+constexpr T
+read(std::span<const std::byte> d)
+{
+	return read_advance<T>(d);
+}
+
+template<typename T>
+void
+write_advance(std::span<std::byte> &d, const T &t)
+{
+	assert(d.size() >= byte_size<T>());
+	if constexpr (std::is_integral_v<T>) {
+		const auto v{byteswap(t)};
+		std::copy_n(reinterpret_cast<const std::byte *>(&v), sizeof(T), data(d));
+		d = d.subspan(sizeof(T));
+	} else {
+		std::apply([&d](const auto &...v) {
+			(write_advance(d, v), ...);
+		}, t);
+	}
+}
+
+/*
+ * byteswap_copy - copy n values of width bytes converting byte order
+ *
+ * Uses SIMD byte shuffles where available. On x86-64 the AVX2 or SSSE3 path
+ * is chosen at run time from the CPU, so it does not depend on the compiler
+ * target flags. The source and destination must not overlap.
+ */
+void byteswap_copy(std::byte *d, const std::byte *s, size_t n, size_t width);
+
+}
+
+template<dtl::cell T>
+void
+set(property &p, const T &v)
+{
+	auto d{p.allocate(dtl::byte_size<T>())};
+	dtl::write_advance(d, v);
+}
+
+template<dtl::cell T>
+void
+set_array(property &p, std::span<const T> v)
+{
+	auto d{p.allocate(size(v) * dtl::byte_size<T>())};
+	if constexpr (std::is_integral_v<T>)
+		dtl::byteswap_copy(data(d),
+				   reinterpret_cast<const std::byte *>(data(v)),
+				   size(v), sizeof(T));
+	else
+		for (const auto &e : v)
+			dtl::write_advance(d, e);
+}
+
+template<class T>
+bool
+is(const property &p)
+{
+	return size(as_bytes(p)) == dtl::byte_size<T>();
+}
+
+template<class T>
+bool
+is_array(const property &p)
+{
+	if (is_empty(p))
+		return false;
+	return size(as_bytes(p)) % dtl::byte_size<T>() == 0;
+}
+
+template<class T>
+result<T>
+try_as(const property &p)
+{
+	if (!is<T>(p))
+		return dtl::fail(errc::incompatible_type);
+	return dtl::read<T>(as_bytes(p));
+}
+
+template<class T>
+T
+as(const property &p)
+{
+	if (!is<T>(p))
+		throw std::invalid_argument{"incompatible type"};
+	return dtl::read<T>(as_bytes(p));
+}
+
+template<class T>
+auto
+as_array(const property &p)
+{
+	if (!is_array<T>(p))
+		throw std::invalid_argument{"incompatible type"};
+	const auto sz{dtl::byte_size<T>()};
+	const auto n{size(as_bytes(p)) / sz};
+#ifdef __cpp_lib_ranges
+	return std::views::iota(decltype(n){0}, n) | std::views::transform(
+		[&p, sz](auto i) {
+			return dtl::read<T>(as_bytes(p).subspan(i * sz));
+	});
+#else
+	std::vector<T> t;
+	t.reserve(n);
+	for (size_t i{0}; i != n; ++i)
+		t.push_back(dtl::read<T>(as_bytes(p).subspan(i * sz)));
+	return t;
+#endif
+}
+
+/*
+ * be_span - view of an array of big-endian values
+ */
+template<class T>
+class be_span {
+public:
+	class iterator;
+
+	be_span() = default;
+	explicit be_span(std::span<const std::byte> d)
+	: d_{d}
+	{
+		assert(d.size() % dtl::byte_size<T>() == 0);
+	}
+
+	size_t size() const { return d_.size() / dtl::byte_size<T>(); }
+	bool empty() const { return d_.empty(); }
+	T operator[](size_t i) const
+	{
+		return dtl::read<T>(d_.subspan(i * dtl::byte_size<T>()));
+	}
+	iterator begin() const { return iterator{d_.data()}; }
+	iterator end() const { return iterator{d_.data() + d_.size()}; }
+	std::span<const std::byte> bytes() const { return d_; }
+	std::span<T> copy_to(std::span<T>) const;
+
+private:
+	std::span<const std::byte> d_;
+};
+
+template<class T>
+class be_span<T>::iterator {
+public:
+	/* values are decoded on access so reference is not a reference */
+	using iterator_concept = std::random_access_iterator_tag;
+	using iterator_category = std::input_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using reference = T;
+	using pointer = void;
+
+	iterator() = default;
+	explicit iterator(const std::byte *p) : p_{p} { }
+
+	T operator*() const { return dtl::read<T>({p_, sz}); }
+	T operator[](difference_type i) const { return *(*this + i); }
+	iterator &operator++() { p_ += sz; return *this; }
+	iterator &operator--() { p_ -= sz; return *this; }
+	iterator operator++(int) { auto t{*this}; ++*this; return t; }
+	iterator operator--(int) { auto t{*this}; --*this; return t; }
+	iterator &operator+=(difference_type n) { p_ += n * sz; return *this; }
+	iterator &operator-=(difference_type n) { p_ -= n * sz; return *this; }
+
+	friend iterator operator+(iterator i, difference_type n) { return i += n; }
+	friend iterator operator+(difference_type n, iterator i) { return i += n; }
+	friend iterator operator-(iterator i, difference_type n) { return i -= n; }
+	friend difference_type operator-(const iterator &l, const iterator &r)
+	{
+		return (l.p_ - r.p_) / static_cast<difference_type>(sz);
+	}
+	friend bool operator==(const iterator &, const iterator &) = default;
+	friend auto operator<=>(const iterator &, const iterator &) = default;
+
+private:
+	static constexpr auto sz{dtl::byte_size<T>()};
+	const std::byte *p_{nullptr};
+};
+
+template<class T>
+std::span<T>
+be_span<T>::copy_to(std::span<T> o) const
+{
+	const auto n{size()};
+	if (o.size() < n)
+		throw std::invalid_argument{"buffer too small"};
+	if constexpr (std::is_integral_v<T>)
+		dtl::byteswap_copy(reinterpret_cast<std::byte *>(o.data()),
+				   d_.data(), n, sizeof(T));
+	else {
+		auto d{d_};
+		for (size_t i{0}; i != n; ++i)
+			o[i] = dtl::read_advance<T>(d);
+	}
+	return o.first(n);
+}
+
+template<class T>
+be_span<T>
+as_be_span(const property &p)
+{
+	if (!is_array<T>(p))
+		throw std::invalid_argument{"incompatible type"};
+	return be_span<T>{as_bytes(p)};
+}
+
+template<class T>
+std::span<T>
+as_array_into(const property &p, std::span<T> o)
+{
+	return as_be_span<T>(p).copy_to(o);
+}
+
+namespace dtl {
+
+/*
+ * walker - range for preorder and postorder
+ */
+template<class Piece, bool Post>
+class walker {
+	using Node = std::conditional_t<std::is_const_v<Piece>, const node, node>;
+
+	struct frame {
+		Node *node;
+		node::piece_set::const_iterator it;
+		bool subnodes;
+	};
+
+public:
+	class iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = visit<Piece>;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+		explicit iterator(Node &n)
+		: stack_{resource(n)}
+		{
+			if constexpr (Post) {
+				push(n);
+				next();
+			} else
+				cur_ = &n;
+		}
+
+		visit<Piece> operator*() const { return {*cur_, depth_}; }
+
+		iterator &operator++()
+		{
+			if constexpr (!Post) {
+				if (descend_ && is_node(*cur_))
+					push(as_node(*cur_));
+				descend_ = true;
+			}
+			next();
+			return *this;
+		}
+
+		void operator++(int) { ++*this; }
+
+		void skip() requires (!Post) { descend_ = false; }
+
+		friend bool operator==(const iterator &i, std::default_sentinel_t)
+		{
+			return !i.cur_;
+		}
+
+	private:
+		void push(Node &n)
+		{
+			stack_.push_back({&n, n.children_.begin(), false});
+		}
+
+		void next();
+
+		/* allocated from the resource of the tree being walked */
+		std::pmr::vector<frame> stack_;
+		Piece *cur_{nullptr};
+		size_t depth_{0};
+		bool descend_{true};
+	};
+
+	explicit walker(Node &n) : start_{&n} { }
+
+	iterator begin() const { return iterator{*start_}; }
+	std::default_sentinel_t end() const { return {}; }
+
+private:
+	Node *start_;
+};
+
+/*
+ * walker::iterator::next - move to next piece
+ *
+ * Each frame makes two passes over the children of its node, the first for
+ * properties and the second for subnodes.
+ */
+template<class Piece, bool Post>
+void
+walker<Piece, Post>::iterator::next()
+{
+	while (!stack_.empty()) {
+		auto &f{stack_.back()};
+		const auto &c{f.node->children_};
+		while (f.it != c.end() && is_node(**f.it) != f.subnodes)
+			++f.it;
+		if (f.it != c.end()) {
+			Piece &p{**f.it++};
+			if constexpr (Post) {
+				if (f.subnodes) {
+					push(as_node(p));
+					continue;
+				}
+			}
+			cur_ = &p;
+			depth_ = stack_.size();
+			return;
+		}
+		if (!f.subnodes) {
+			f.subnodes = true;
+			f.it = c.begin();
+			continue;
+		}
+		if constexpr (Post) {
+			cur_ = f.node;
+			depth_ = stack_.size() - 1;
+			stack_.pop_back();
+			return;
+		}
+		stack_.pop_back();
+	}
+	cur_ = nullptr;
+}
+
+/*
+ * unit_bound - search key ordered as name followed by sep
+ *
+ * Used with node::set_compare to find the range of children called
+ * name@unit-address without building the key string.
+ */
+struct unit_bound {
+	std::string_view name;
+	char sep;
+
+	friend constexpr bool operator<(const unit_bound &l, std::string_view r)
+	{
+		return compare(r, l) > 0;
+	}
+
+	friend constexpr bool operator<(std::string_view l, const unit_bound &r)
+	{
+		return compare(l, r) < 0;
+	}
+
+private:
+	static constexpr int compare(std::string_view s, const unit_bound &b)
+	{
+		if (const auto r{s.substr(0, size(b.name)).compare(b.name)}; r)
+			return r;
+		if (size(s) == size(b.name))
+			return -1;
+		using traits = std::string_view::traits_type;
+		if (traits::lt(s[size(b.name)], b.sep))
+			return -1;
+		if (traits::lt(b.sep, s[size(b.name)]) || size(s) > size(b.name) + 1)
+			return 1;
+		return 0;
+	}
+};
+
+/*
+ * named_range - range of subnodes with the same node-name
+ *
+ * exact() returns the child called name, which may be a property. find()
+ * looks up that child alone, without searching for unit addresses.
+ */
+template<class Node>
+class named_range {
+	using Piece = std::conditional_t<std::is_const_v<Node>, const piece, piece>;
+	using set_iterator = node::piece_set::const_iterator;
+
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Node;
+		using difference_type = std::ptrdiff_t;
+		using pointer = Node *;
+		using reference = Node &;
+
+		iterator() = default;
+		iterator(Piece *first, set_iterator it) : first_{first}, it_{it} { }
+
+		Node &operator*() const { return as_node(first_ ? *first_ : **it_); }
+		Node *operator->() const { return &**this; }
+
+		iterator &operator++()
+		{
+			if (first_)
+				first_ = nullptr;
+			else
+				++it_;
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			auto t{*this};
+			++*this;
+			return t;
+		}
+
+		friend bool operator==(const iterator &, const iterator &) = default;
+
+	private:
+		Piece *first_{nullptr};
+		set_iterator it_;
+	};
+
+	named_range(Node &n, std::string_view name)
+	{
+		const auto &c{n.children_};
+		exact_ = find(n, name);
+		first_ = c.lower_bound(unit_bound{name, '@'});
+		last_ = c.lower_bound(unit_bound{name, '@' + 1});
+	}
 
-template<typename T>
-T
-read(std::span<const std::byte> d)
-{
-	return read_advance<T>(d);
-}
+	Piece *exact() const { return exact_; }
 
-}
+	static Piece *find(Node &n, std::string_view name)
+	{
+		const auto &c{n.children_};
+		const auto it{c.find(name)};
+		return it != c.end() ? it->get() : nullptr;
+	}
 
-template<class T>
-bool
-is(const property &p)
-{
-	return size(as_bytes(p)) == dtl::byte_size<T>();
-}
+	iterator begin() const
+	{
+		return {exact_ && is_node(*exact_) ? exact_ : nullptr, first_};
+	}
+
+	iterator end() const { return {nullptr, last_}; }
+
+	bool empty() const { return begin() == end(); }
+
+private:
+	Piece *exact_{nullptr};
+	set_iterator first_;
+	set_iterator last_;
+};
 
-template<class T>
-bool
-is_array(const property &p)
-{
-	if (is_empty(p))
-		return false;
-	return size(as_bytes(p)) % dtl::byte_size<T>() == 0;
 }
 
-template<class T>
-T
-as(const property &p)
+template<class Node>
+auto
+preorder(Node &n)
 {
-	if (!is<T>(p))
-		throw std::invalid_argument{"incompatible type"};
-	return dtl::read<T>(as_bytes(p));
+	using Piece = std::conditional_t<std::is_const_v<Node>, const piece, piece>;
+	return dtl::walker<Piece, false>{n};
 }
 
-template<class T>
+template<class Node>
 auto
-as_array(const property &p)
+postorder(Node &n)
 {
-	if (!is_array<T>(p))
-		throw std::invalid_argument{"incompatible type"};
-	const auto sz{dtl::byte_size<T>()};
-	const auto n{size(as_bytes(p)) / sz};
-#ifdef __cpp_lib_ranges
-	return std::views::iota(decltype(n){0}, n) | std::views::transform(
-		[&p, sz](auto i) {
-			return dtl::read<T>(as_bytes(p).subspan(i * sz));
-	});
-#else
-	std::vector<T> t;
-	t.reserve(n);
-	for (size_t i{0}; i != n; ++i)
-		t.push_back(dtl::read<T>(as_bytes(p).subspan(i * sz)));
-	return t;
-#endif
+	using Piece = std::conditional_t<std::is_const_v<Node>, const piece, piece>;
+	return dtl::walker<Piece, true>{n};
 }
 
 template<class Key>
@@ -559,10 +2155,22 @@ template<class T, class ...A>
 T &
 node::add(std::string_view name, A &&...a)
 {
-	auto r = children_.emplace(std::make_unique<T>(*this, name,
-						       std::forward<A>(a)...));
+	/* pieces have different sizes, so they are allocated from the
+	 * resource directly rather than through the allocator of the set */
+	const auto &res{children_.get_allocator().resource()};
+	void *m{res->allocate(sizeof(T), alignof(std::max_align_t))};
+	piece_p p;
+	try {
+		p = piece_p{new (m) T(*this, name, std::forward<A>(a)...),
+			    {res, sizeof(T)}};
+	} catch (...) {
+		res->deallocate(m, sizeof(T), alignof(std::max_align_t));
+		throw;
+	}
+	auto r = children_.emplace(std::move(p));
 	if (!r.second)
 		throw std::invalid_argument{"name exists"};
+	modified();
 	return static_cast<T &>(**r.first);
 }
 
@@ -617,6 +2225,715 @@ subnodes(Node &n)
 #endif
 }
 
+template<class Node>
+auto
+subnodes(Node &n, std::string_view name)
+{
+	return dtl::named_range<Node>{n, name};
+}
+
+namespace dtl {
+
+template<class T> struct is_optional : std::false_type { };
+template<class T> struct is_optional<std::optional<T>> : std::true_type { };
+template<class T> struct is_vector : std::false_type { };
+template<class T> struct is_vector<std::vector<T>> : std::true_type { };
+
+/*
+ * bind_value - convert property for binding to member of type T
+ */
+template<class T>
+T
+bind_value(const property &p)
+{
+	if constexpr (std::is_same_v<T, std::string_view>)
+		return as_string(p);
+	else if constexpr (std::is_same_v<T, std::string>)
+		return T{as_string(p)};
+	else if constexpr (is_vector<T>::value) {
+		T v;
+		for (const auto &e : as_array<typename T::value_type>(p))
+			v.push_back(e);
+		return v;
+	} else
+		return as<T>(p);
+}
+
+/*
+ * bind_member - make binding member for member m of S
+ */
+template<class S, class M>
+typename binding<S>::member
+bind_member(std::string_view name, M S::*m, bool required)
+{
+	typename binding<S>::member r{std::string{name}, required, {}, {}};
+	if constexpr (std::is_same_v<M, bool>) {
+		r.set = [m](S &s, const property &) { s.*m = true; };
+		r.reset = [m](S &s) { s.*m = false; };
+	} else if constexpr (is_optional<M>::value) {
+		r.set = [m](S &s, const property &p) {
+			s.*m = bind_value<typename M::value_type>(p);
+		};
+		r.reset = [m](S &s) { (s.*m).reset(); };
+	} else {
+		r.set = [m](S &s, const property &p) {
+			s.*m = bind_value<M>(p);
+		};
+		r.reset = [](S &) { };
+	}
+	return r;
+}
+
+}
+
+template<class S>
+binding<S>::binding(std::initializer_list<member> m)
+: members_{m}
+{
+	std::sort(begin(members_), end(members_), [](auto &l, auto &r) {
+		return l.name < r.name;
+	});
+	if (std::adjacent_find(begin(members_), end(members_),
+	    [](auto &l, auto &r) { return l.name == r.name; }) != end(members_))
+		throw std::invalid_argument{"duplicate field"};
+}
+
+template<class S, class M>
+typename binding<S>::member
+field(std::string_view name, M S::*m)
+{
+	return dtl::bind_member(name, m, false);
+}
+
+template<class S, class M>
+typename binding<S>::member
+required_field(std::string_view name, M S::*m)
+{
+	return dtl::bind_member(name, m, true);
+}
+
+/*
+ * bind - merge sorted properties with sorted binding members
+ */
+template<class S>
+void
+bind(const node &n, const binding<S> &b, S &s)
+{
+	auto m{begin(b.members_)};
+	auto missing = [&s](auto &m) {
+		if (m.required)
+			throw std::invalid_argument{"missing property"};
+		m.reset(s);
+	};
+	for (const property &p : properties(n)) {
+		for (; m != end(b.members_) && m->name < name(p); ++m)
+			missing(*m);
+		if (m == end(b.members_))
+			return;
+		if (m->name == name(p))
+			(m++)->set(s, p);
+	}
+	for (; m != end(b.members_); ++m)
+		missing(*m);
+}
+
+/*
+ * static_node, static_property
+ */
+constexpr std::string_view
+name(const static_node &n)
+{
+	return n.name;
+}
+
+constexpr std::string_view
+name(const static_property &p)
+{
+	return p.name;
+}
+
+constexpr std::optional<std::reference_wrapper<const static_node>>
+parent(const static_node &n)
+{
+	if (!n.parent)
+		return std::nullopt;
+	return *n.parent;
+}
+
+constexpr std::span<const static_node>
+subnodes(const static_node &n)
+{
+	return n.subnodes;
+}
+
+constexpr std::span<const static_property>
+properties(const static_node &n)
+{
+	return n.properties;
+}
+
+constexpr std::span<const region>
+reg(const static_node &n)
+{
+	return n.reg;
+}
+
+constexpr bool
+is_compatible(const static_node &n, std::string_view c)
+{
+	return std::find(begin(n.compatible), end(n.compatible), c) !=
+	       end(n.compatible);
+}
+
+inline std::span<const std::byte>
+as_bytes(const static_property &p)
+{
+	return std::as_bytes(std::span{p.value});
+}
+
+constexpr std::string_view
+as_string(const static_property &p)
+{
+	const auto &v{p.value};
+	if (empty(v) || v.find('\0') != size(v) - 1)
+		throw std::invalid_argument{"incompatible type"};
+	return v.substr(0, size(v) - 1);
+}
+
+template<class T>
+constexpr T
+as(const static_property &p)
+{
+	if (size(p.value) != dtl::byte_size<T>())
+		throw std::invalid_argument{"incompatible type"};
+	if (std::is_constant_evaluated()) {
+		std::array<std::byte, dtl::byte_size<T>()> b;
+		std::transform(begin(p.value), end(p.value), begin(b),
+		    [](char c) { return static_cast<std::byte>(c); });
+		return dtl::read<T>(b);
+	}
+	return dtl::read<T>(as_bytes(p));
+}
+
+namespace dtl {
+
+/*
+ * static_step - find subnode of static node by path component
+ */
+constexpr result<std::reference_wrapper<const static_node>>
+static_step(const static_node &n, std::string_view c)
+{
+	if (empty(c))
+		return fail(errc::bad_path);
+	const auto &s{n.subnodes};
+	const auto it{std::lower_bound(begin(s), end(s), c,
+	    [](auto &l, auto &r) { return l.name < r; })};
+	if (it != end(s) && it->name == c)
+		return std::cref(*it);
+	/* unit address is optional in node name if unambiguous */
+	const auto first{std::lower_bound(begin(s), end(s), unit_bound{c, '@'},
+	    [](auto &l, auto &r) { return l.name < r; })};
+	const auto last{std::lower_bound(first, end(s), unit_bound{c, '@' + 1},
+	    [](auto &l, auto &r) { return l.name < r; })};
+	if (first == last)
+		return fail(errc::not_found);
+	if (last - first != 1)
+		return fail(errc::ambiguous_path);
+	return std::cref(*first);
+}
+
+/*
+ * static_parent - find node containing last component of path
+ */
+constexpr result<std::reference_wrapper<const static_node>>
+static_parent(const static_node &n, std::string_view &path)
+{
+	const static_node *p{&n};
+	for (auto sep{path.find('/')}; sep != std::string_view::npos;
+	    sep = path.find('/')) {
+		const auto &r{static_step(*p, path.substr(0, sep))};
+		if (!r)
+			return r;
+		p = &r->get();
+		path.remove_prefix(sep + 1);
+	}
+	return std::cref(*p);
+}
+
+template<class T>
+constexpr const T &
+static_value(const result<std::reference_wrapper<const T>> &r)
+{
+	if (r)
+		return *r;
+	if (r.error() == errc::bad_path)
+		throw std::invalid_argument{"bad path"};
+	if (r.error() == errc::ambiguous_path)
+		throw std::invalid_argument{"ambiguous path"};
+	throw std::bad_optional_access{};
+}
+
+}
+
+constexpr result<std::reference_wrapper<const static_node>>
+try_get_node(const static_node &n, std::string_view path)
+{
+	const auto &p{dtl::static_parent(n, path)};
+	if (!p)
+		return p;
+	return dtl::static_step(*p, path);
+}
+
+constexpr result<std::reference_wrapper<const static_property>>
+try_get_property(const static_node &n, std::string_view path)
+{
+	const auto &p{dtl::static_parent(n, path)};
+	if (!p)
+		return dtl::fail(p.error());
+	if (empty(path))
+		return dtl::fail(errc::bad_path);
+	const auto &s{p->get().properties};
+	const auto it{std::lower_bound(begin(s), end(s), path,
+	    [](auto &l, auto &r) { return l.name < r; })};
+	if (it == end(s) || it->name != path)
+		return dtl::fail(errc::not_found);
+	return std::cref(*it);
+}
+
+constexpr const static_node &
+get_node(const static_node &n, std::string_view path)
+{
+	return dtl::static_value(try_get_node(n, path));
+}
+
+constexpr const static_property &
+get_property(const static_node &n, std::string_view path)
+{
+	return dtl::static_value(try_get_property(n, path));
+}
+
+namespace dtl {
+
+/*
+ * static_tables - tables for static_node parsed from a blob
+ *
+ * Indices refer to the vectors, nodes are breadth first.
+ */
+struct static_tables {
+	static constexpr size_t none{SIZE_MAX};
+
+	struct entry {
+		std::string_view name;
+		size_t parent;
+		size_t subnodes, subnode_count;
+		size_t properties, property_count;
+		size_t regions, region_count;
+		size_t strings, string_count;
+	};
+
+	std::vector<entry> nodes;
+	std::vector<static_property> properties;
+	std::vector<region> regions;
+	std::vector<std::string_view> strings;
+};
+
+/*
+ * static_be32 - read big-endian 32-bit value from blob
+ */
+constexpr uint32_t
+static_be32(std::string_view d, size_t off)
+{
+	if (off > size(d) || size(d) - off < 4)
+		throw std::invalid_argument{"bad blob"};
+	uint32_t v{0};
+	for (size_t i{0}; i != 4; ++i)
+		v = v << 8 | static_cast<unsigned char>(d[off + i]);
+	return v;
+}
+
+/*
+ * static_cells - read cells from value, truncating to 64 bits
+ */
+constexpr uint64_t
+static_cells(std::string_view &v, unsigned cells)
+{
+	uint64_t r{0};
+	for (unsigned i{0}; i != cells; ++i) {
+		r = r << 32 | static_be32(v, 0);
+		v.remove_prefix(4);
+	}
+	return r;
+}
+
+/*
+ * next_string - take next null terminated string from value
+ *
+ * The final string may omit its terminator.
+ */
+constexpr std::string_view
+next_string(std::string_view &v)
+{
+	const auto s{v.substr(0, v.find('\0'))};
+	v.remove_prefix(std::min(size(s) + 1, size(v)));
+	return s;
+}
+
+/*
+ * parse_static - parse blob into static tables
+ *
+ * Malformed blobs, cell counts, reg and ranges are rejected. reg is left
+ * empty, as by fdtgen, if a bus on its path has no ranges or no range
+ * covers its address.
+ */
+constexpr static_tables
+parse_static(std::string_view b)
+{
+	auto bad = [] { throw std::invalid_argument{"bad blob"}; };
+
+	/* header */
+	if (static_be32(b, 0) != 0xd00dfeed)
+		bad();
+	const auto total{static_be32(b, 4)};
+	if (total > size(b) || static_be32(b, 20) < 16)
+		bad();
+	b = b.substr(0, total);
+	const auto st{b.substr(static_be32(b, 12))};
+	size_t off{static_be32(b, 8)};
+
+	/* structure block, nodes in blob order */
+	struct raw {
+		std::string_view name;
+		size_t parent;
+		std::vector<size_t> subnodes;
+		std::vector<static_property> properties;
+	};
+	std::vector<raw> raws;
+	size_t cur{static_tables::none};
+	auto align = [](size_t v) { return (v + 3) & ~size_t{3}; };
+	for (bool done{false}; !done;) {
+		const auto token{static_be32(b, off)};
+		off += 4;
+		switch (token) {
+		case 1: {	/* FDT_BEGIN_NODE */
+			const auto e{b.find('\0', off)};
+			if (e == std::string_view::npos)
+				bad();
+			if (cur == static_tables::none && !empty(raws))
+				bad();
+			if (cur != static_tables::none)
+				raws[cur].subnodes.push_back(size(raws));
+			raws.push_back({b.substr(off, e - off), cur, {}, {}});
+			cur = size(raws) - 1;
+			off = align(e + 1);
+			break;
+		}
+		case 2:		/* FDT_END_NODE */
+			if (cur == static_tables::none)
+				bad();
+			cur = raws[cur].parent;
+			break;
+		case 3: {	/* FDT_PROP */
+			const auto len{static_be32(b, off)};
+			const auto no{static_be32(b, off + 4)};
+			off += 8;
+			if (cur == static_tables::none || off + len > size(b) ||
+			    no >= size(st))
+				bad();
+			const auto e{st.find('\0', no)};
+			if (e == std::string_view::npos)
+				bad();
+			const auto n{st.substr(no, e - no)};
+			raws[cur].properties.push_back({n, b.substr(off, len)});
+			off = align(off + len);
+			break;
+		}
+		case 4:		/* FDT_NOP */
+			break;
+		case 9:		/* FDT_END */
+			done = true;
+			break;
+		default:
+			bad();
+		}
+	}
+	if (empty(raws) || cur != static_tables::none)
+		bad();
+
+	/* breadth first with subnodes and properties sorted by name */
+	static_tables t;
+	auto by_name = [](auto &l, auto &r) { return l.name < r.name; };
+	std::vector<size_t> order{0}, pos(size(raws));
+	for (size_t i{0}; i != size(order); ++i) {
+		auto &r{raws[order[i]]};
+		std::sort(begin(r.subnodes), end(r.subnodes),
+		    [&](size_t x, size_t y) { return raws[x].name < raws[y].name; });
+		std::sort(begin(r.properties), end(r.properties), by_name);
+		t.nodes.push_back({r.name,
+		    r.parent == static_tables::none ? r.parent : pos[r.parent],
+		    size(order), size(r.subnodes),
+		    size(t.properties), size(r.properties), 0, 0, 0, 0});
+		for (auto s : r.subnodes) {
+			pos[s] = size(order);
+			order.push_back(s);
+		}
+		t.properties.insert(end(t.properties), begin(r.properties),
+				    end(r.properties));
+	}
+
+	auto prop = [&](size_t n, std::string_view name) {
+		const auto &e{t.nodes[n]};
+		const auto f{begin(t.properties) + e.properties};
+		const auto l{f + e.property_count};
+		const auto it{std::lower_bound(f, l, name,
+		    [](auto &p, auto &n) { return p.name < n; })};
+		return it != l && it->name == name ? &*it : nullptr;
+	};
+	auto cells = [&](size_t n, std::string_view name, unsigned def) {
+		const auto p{prop(n, name)};
+		if (!p)
+			return def;
+		if (size(p->value) != 4 || static_be32(p->value, 0) > 4)
+			bad();
+		return static_cast<unsigned>(static_be32(p->value, 0));
+	};
+	auto translate = [&](size_t bus, uint64_t a) -> std::optional<uint64_t> {
+		for (; t.nodes[bus].parent != static_tables::none;
+		    bus = t.nodes[bus].parent) {
+			const auto rp{prop(bus, "ranges")};
+			if (!rp)
+				return std::nullopt;
+			if (empty(rp->value))
+				continue;
+			const auto ac{cells(bus, "#address-cells", 2)};
+			const auto sc{cells(bus, "#size-cells", 1)};
+			const auto pac{cells(t.nodes[bus].parent, "#address-cells", 2)};
+			if (!ac || !pac || size(rp->value) % ((ac + pac + sc) * 4))
+				bad();
+			bool found{false};
+			for (auto v{rp->value}; !empty(v) && !found;) {
+				const auto c{static_cells(v, ac)};
+				const auto p{static_cells(v, pac)};
+				const auto s{static_cells(v, sc)};
+				if (a >= c && a - c < s) {
+					a = a - c + p;
+					found = true;
+				}
+			}
+			if (!found)
+				return std::nullopt;
+		}
+		return a;
+	};
+
+	/* decoded reg and compatible */
+	for (size_t i{0}; i != size(t.nodes); ++i) {
+		auto &e{t.nodes[i]};
+		e.regions = size(t.regions);
+		e.strings = size(t.strings);
+		if (const auto rp{prop(i, "reg")}; rp && e.parent != static_tables::none) {
+			const auto ac{cells(e.parent, "#address-cells", 2)};
+			const auto sc{cells(e.parent, "#size-cells", 1)};
+			if (!ac || size(rp->value) % ((ac + sc) * 4))
+				bad();
+			std::vector<region> r;
+			for (auto v{rp->value}; !empty(v);) {
+				const auto a{translate(e.parent, static_cells(v, ac))};
+				const auto s{static_cells(v, sc)};
+				if (!a) {
+					r.clear();
+					break;
+				}
+				r.push_back({*a, s});
+			}
+			t.regions.insert(end(t.regions), begin(r), end(r));
+			e.region_count = size(r);
+		}
+		if (const auto cp{prop(i, "compatible")};
+		    cp && !empty(cp->value) && cp->value.back() == '\0') {
+			for (auto v{cp->value}; !empty(v);) {
+				const auto s{next_string(v)};
+				if (empty(s))
+					continue;
+				t.strings.push_back(s);
+				++e.string_count;
+			}
+		}
+	}
+	return t;
+}
+
+template<class B>
+constexpr static_sizes
+static_sizes_of(const B &blob)
+{
+	std::string d(std::size(blob), '\0');
+	for (size_t i{0}; i != size(d); ++i)
+		d[i] = static_cast<char>(blob[i]);
+	const auto &t{parse_static(d)};
+	return {size(d), size(t.nodes), size(t.properties), size(t.regions),
+		size(t.strings)};
+}
+
+/*
+ * static_tree - storage for static_fdt
+ *
+ * The tables refer to a copy of the blob held in the same object, so a
+ * static_tree must be initialised in place.
+ */
+template<static_sizes S>
+class static_tree {
+public:
+	template<class B>
+	constexpr explicit static_tree(const B &blob)
+	{
+		for (size_t i{0}; i != S.size; ++i)
+			data_[i] = static_cast<char>(blob[i]);
+		const auto &t{parse_static({data(data_), S.size})};
+		std::copy(begin(t.properties), end(t.properties), begin(properties_));
+		std::copy(begin(t.regions), end(t.regions), begin(regions_));
+		std::copy(begin(t.strings), end(t.strings), begin(strings_));
+		for (size_t i{0}; i != S.nodes; ++i) {
+			const auto &e{t.nodes[i]};
+			nodes_[i] = {
+				e.name,
+				e.parent == static_tables::none ? nullptr
+								: &nodes_[e.parent],
+				{data(nodes_) + e.subnodes, e.subnode_count},
+				{data(properties_) + e.properties, e.property_count},
+				{data(regions_) + e.regions, e.region_count},
+				{data(strings_) + e.strings, e.string_count},
+			};
+		}
+	}
+
+	static_tree(const static_tree &) = delete;
+	static_tree &operator=(const static_tree &) = delete;
+
+	friend constexpr const static_node &
+	root(const static_tree &t)
+	{
+		return t.nodes_[0];
+	}
+
+private:
+	std::array<char, S.size> data_{};
+	std::array<static_node, S.nodes> nodes_{};
+	std::array<static_property, S.properties> properties_{};
+	std::array<region, S.regions> regions_{};
+	std::array<std::string_view, S.strings> strings_{};
+};
+
+/*
+ * compact_range - range of consecutive compact or frozen records
+ */
+template<class Handle>
+class compact_range {
+	using tables_p = decltype(Handle::tables);
+
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Handle;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Handle;
+
+		iterator() = default;
+		iterator(tables_p t, uint32_t i)
+		: t_{t}
+		, i_{i}
+		{ }
+
+		Handle operator*() const { return {t_, i_}; }
+		iterator &operator++() { ++i_; return *this; }
+		iterator operator++(int) { auto r{*this}; ++i_; return r; }
+		bool operator==(const iterator &) const = default;
+
+	private:
+		tables_p t_{nullptr};
+		uint32_t i_{0};
+	};
+
+	compact_range(tables_p t, uint32_t first, uint32_t last)
+	: t_{t}
+	, first_{first}
+	, last_{last}
+	{ }
+
+	iterator begin() const { return {t_, first_}; }
+	iterator end() const { return {t_, last_}; }
+	size_t size() const { return last_ - first_; }
+	bool empty() const { return first_ == last_; }
+
+private:
+	tables_p t_;
+	uint32_t first_;
+	uint32_t last_;
+};
+
+/*
+ * sibling_range - range of frozen nodes with the same parent
+ *
+ * Iteration skips over the subtree of each node.
+ */
+class sibling_range {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = frozen_node;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = frozen_node;
+
+		iterator() = default;
+		iterator(const frozen_tables *t, uint32_t i)
+		: t_{t}
+		, i_{i}
+		{ }
+
+		frozen_node operator*() const { return {t_, i_}; }
+		iterator &operator++();
+		iterator operator++(int) { auto r{*this}; ++*this; return r; }
+		bool operator==(const iterator &) const = default;
+
+	private:
+		const frozen_tables *t_{nullptr};
+		uint32_t i_{0};
+	};
+
+	sibling_range(const frozen_tables *t, uint32_t first, uint32_t last)
+	: t_{t}
+	, first_{first}
+	, last_{last}
+	{ }
+
+	iterator begin() const { return {t_, first_}; }
+	iterator end() const { return {t_, last_}; }
+	bool empty() const { return first_ == last_; }
+
+private:
+	const frozen_tables *t_;
+	uint32_t first_;
+	uint32_t last_;
+};
+
+}
+
+/*
+ * compact_property
+ */
+template<class T>
+T
+as(compact_property p)
+{
+	const auto &v{as_bytes(p)};
+	if (size(v) != dtl::byte_size<T>())
+		throw std::invalid_argument{"incompatible type"};
+	return dtl::read<T>(v);
+}
+
 template<class ...T>
 property &
 add_property(node &n, std::string_view name, T &&...value)
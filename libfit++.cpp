@@ -298,7 +298,7 @@ get_hash_value(const fdt::node &n, std::string_view algo)
  */
 void
 hash_raw_nodes(const std::span<const std::byte> fdt,
-	       const std::span<const std::string_view> nodes,
+	       const fdt::stringlist &nodes,
 	       const std::span<const std::string_view> exclude_props,
 	       ltc_hash &hash)
 {
@@ -635,6 +635,7 @@ verify_config_signatures(const fdt::node &n, const get_public_key_fn &get_key,
 
 	auto have_signature{false};
 	std::vector<std::string_view> verified_images;
+	const auto &config_path{path(n)};
 
 	for (const auto &s : subnodes(n)) {
 		if (!name(s).starts_with("signature"))
@@ -663,7 +664,7 @@ verify_config_signatures(const fdt::node &n, const get_public_key_fn &get_key,
 			continue;
 
 		/* sanity check - configuration must hash itself */
-		if (!contains(hashed_nodes, path(n)))
+		if (!contains(hashed_nodes, config_path))
 			return false;
 
 		/* verify hash on all signed images */
@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 
 #include "../libfdt++.h"
+#include "static.dtb.h"
 
+#include <cstring>
 #include <fcntl.h>
+#include <mutex>
+#include <thread>
 
 namespace {
 
@@ -17,9 +21,7 @@ using std::ranges::equal;
 #else
 bool equal(const auto &l, const auto &r)
 {
-	if (size(l) != size(r))
-		return false;
-	return std::equal(begin(l), end(l), begin(r));
+	return std::equal(l.begin(), l.end(), r.begin(), r.end());
 }
 #endif
 
@@ -36,6 +38,28 @@ TEST(piece, path)
 	EXPECT_EQ(path(get_property(f, "/l1@1/l2@1/reg")), "/l1@1/l2@1/reg");
 }
 
+TEST(piece, path_reuse)
+{
+	auto f{fdt::load("path.dtb")};
+	std::string s{"stale contents which are longer than any path"};
+	std::array<char, 16> b;
+
+	/* path(piece &, std::string &) */
+	path(get_property(f, "/l1@1/l2@1/reg"), s);
+	EXPECT_EQ(s, "/l1@1/l2@1/reg");
+	path(root(f), s);
+	EXPECT_EQ(s, "/");
+
+	/* path(piece &, std::span<char>) */
+	EXPECT_EQ(path(get_node(f, "/l1@2/l2@1"), b), 10u);
+	EXPECT_EQ(std::string_view(data(b), 10), "/l1@2/l2@1");
+	EXPECT_EQ(path(root(f), b), 1u);
+	EXPECT_EQ(b[0], '/');
+	b.fill(0);
+	EXPECT_EQ(path(get_property(f, "/l1@1/l2@1/l1#1-l2#1-prop"), b), 25u);
+	EXPECT_EQ(b[0], 0);
+}
+
 TEST(piece, parent)
 {
 	auto f{fdt::load("path.dtb")};
@@ -72,6 +96,17 @@ TEST(piece, root)
 	EXPECT_EQ(&root(get_property(fc, "/l1@1/l2@1/l1#1-l2#1-prop")), &root(fc));
 }
 
+TEST(piece, root_detached)
+{
+	fdt::node r;
+	auto &n{add_node(add_node(r, "l1"), "l2")};
+	const auto &cn{n};
+
+	EXPECT_EQ(&root(n), &r);
+	EXPECT_EQ(&root(cn), &r);
+	EXPECT_EQ(&root(r), &r);
+}
+
 TEST(piece, conversion)
 {
 	auto f{fdt::load("basic.dtb")};
@@ -140,7 +175,86 @@ TEST(property, set_stringlist)
 	const std::vector<std::string_view> val{"hello", "world!"};
 	set(p, val);
 
-	EXPECT_EQ(as_stringlist(p), val);
+	EXPECT_TRUE(equal(as_stringlist(p), val));
+}
+
+TEST(property, set_T)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	set(p, uint16_t{0x1234});
+	EXPECT_TRUE(equal(as_bytes(p), std::array{0x12_b, 0x34_b}));
+
+	using T1 = std::pair<uint32_t, uint64_t>;
+	set<T1>(p, {0x01020304, 0x05060708090a0b0c});
+	EXPECT_TRUE(equal(as_bytes(p), std::array{
+		0x01_b, 0x02_b, 0x03_b, 0x04_b, 0x05_b, 0x06_b,
+		0x07_b, 0x08_b, 0x09_b, 0x0a_b, 0x0b_b, 0x0c_b}));
+	EXPECT_EQ(as<T1>(p), T1(0x01020304, 0x05060708090a0b0c));
+
+	using T2 = std::tuple<uint8_t, uint16_t, std::array<uint32_t, 2>, uint64_t>;
+	const T2 val{1, 2, {3, 4}, 5};
+	set(p, val);
+	EXPECT_EQ(size(as_bytes(p)), 19u);
+	EXPECT_EQ(as<T2>(p), val);
+
+	/* arrays of bytes are raw values, not cells */
+	static_assert(!fdt::dtl::cell<std::array<std::byte, 4>>);
+	static_assert(!fdt::dtl::cell<std::tuple<>>);
+	const std::array a{0x0a_b, 0x0b_b, 0x0c_b};
+	set(p, a);
+	EXPECT_TRUE(equal(as_bytes(p), a));
+}
+
+TEST(property, set_container)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	/* storage of a moved container is adopted */
+	std::vector v{0x01_b, 0x02_b, 0x03_b};
+	const auto d{data(v)};
+	set(p, std::move(v));
+	EXPECT_EQ(data(as_bytes(p)), d);
+	EXPECT_TRUE(equal(as_bytes(p), std::array{0x01_b, 0x02_b, 0x03_b}));
+}
+
+template<class T>
+void
+test_set_array(fdt::property &p, size_t n)
+{
+	std::vector<T> v(n);
+	for (size_t i{0}; i != n; ++i)
+		v[i] = static_cast<T>(0x0102030405060708 * (i + 1));
+	set_array<T>(p, v);
+	ASSERT_EQ(size(as_bytes(p)), n * sizeof(T));
+	EXPECT_TRUE(equal(as_array<T>(p), v));
+	for (size_t i{0}; i != n; ++i)
+		EXPECT_EQ(as_bytes(p)[i * sizeof(T)],
+			  static_cast<std::byte>(v[i] >> (sizeof(T) * 8 - 8)));
+}
+
+TEST(property, set_array)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	/* exercise vector and scalar paths */
+	for (auto n : {1, 3, 4, 8, 15, 16, 17, 33, 1000}) {
+		test_set_array<uint8_t>(p, n);
+		test_set_array<uint16_t>(p, n);
+		test_set_array<uint32_t>(p, n);
+		test_set_array<uint64_t>(p, n);
+	}
+
+	using T = std::pair<uint32_t, uint64_t>;
+	const std::array<T, 2> val{T{1, 2}, T{3, 4}};
+	set_array<T>(p, val);
+	EXPECT_TRUE(equal(as_array<T>(p), val));
+
+	set_array<uint32_t>(p, {});
+	EXPECT_TRUE(is_empty(p));
 }
 
 TEST(property, is_empty)
@@ -891,9 +1005,9 @@ TEST(property, as_stringlist)
 	EXPECT_THROW(as_stringlist(get_property(f, "/property-u32")), std::invalid_argument);
 	EXPECT_THROW(as_stringlist(get_property(f, "/property-u64")), std::invalid_argument);
 	const std::vector<std::string_view> val_string{"hello world!"};
-	EXPECT_EQ(as_stringlist(get_property(f, "/property-string")), val_string);
+	EXPECT_TRUE(equal(as_stringlist(get_property(f, "/property-string")), val_string));
 	const std::vector<std::string_view> val_stringlist{"hello", "world!"};
-	EXPECT_EQ(as_stringlist(get_property(f, "/property-stringlist")), val_stringlist);
+	EXPECT_TRUE(equal(as_stringlist(get_property(f, "/property-stringlist")), val_stringlist));
 	EXPECT_THROW(as_stringlist(get_property(f, "/property-1")), std::invalid_argument);
 	EXPECT_THROW(as_stringlist(get_property(f, "/property-2")), std::invalid_argument);
 	EXPECT_THROW(as_stringlist(get_property(f, "/property-3")), std::invalid_argument);
@@ -1348,6 +1462,133 @@ TEST(property, as_array_u32_3_array)
 	EXPECT_THROW(as_array<T>(get_property(f, "/property-32")), std::invalid_argument);
 }
 
+TEST(property, is_string_cached)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	set(p, "hello");
+	EXPECT_TRUE(is_string(p));
+	EXPECT_EQ(as_string(p), "hello");
+	set(p, std::vector<std::string_view>{"hello", "world"});
+	EXPECT_FALSE(is_string(p));
+	EXPECT_TRUE(is_stringlist(p));
+
+	auto &q{add_property(root(f), "copy")};
+	set(q, p);
+	EXPECT_FALSE(is_string(q));
+	EXPECT_TRUE(is_stringlist(q));
+
+	auto d{p.allocate(12)};
+	std::fill(begin(d), end(d), 0_b);
+	EXPECT_FALSE(is_stringlist(p));
+	d = p.allocate(3);
+	d[0] = 0x61_b, d[1] = 0x62_b, d[2] = 0_b;
+	EXPECT_EQ(as_string(p), "ab");
+}
+
+TEST(property, stringlist)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	set(p, std::vector<std::string_view>{"", "clk", "", "bus", "ref"});
+	const std::vector<std::string_view> val{"clk", "bus", "ref"};
+	EXPECT_TRUE(equal(as_stringlist(p), val));
+	EXPECT_EQ(stringlist_count(p), 3u);
+	EXPECT_EQ(stringlist_index(p, "bus"), 1u);
+	EXPECT_EQ(stringlist_index(p, "ref"), 2u);
+	EXPECT_EQ(stringlist_index(p, "cl"), std::nullopt);
+	EXPECT_EQ(stringlist_at(p, 0), "clk");
+	EXPECT_EQ(stringlist_at(p, 2), "ref");
+	EXPECT_THROW(stringlist_at(p, 3), std::out_of_range);
+
+	/* empty strings count as in libfdt */
+	static constexpr char v[]{"clk\0\0ref"};
+	set(p, std::as_bytes(std::span{v}));
+	EXPECT_TRUE(equal(as_stringlist(p), std::vector<std::string_view>{"clk", "ref"}));
+	EXPECT_TRUE(equal(as_stringlist(p, fdt::stringlist::empty::keep),
+			  std::vector<std::string_view>{"clk", "", "ref"}));
+	EXPECT_EQ(stringlist_count(p), 3u);
+	EXPECT_EQ(stringlist_index(p, "ref"), 2u);
+	EXPECT_EQ(stringlist_index(p, ""), 1u);
+	EXPECT_EQ(stringlist_at(p, 1), "");
+	EXPECT_EQ(stringlist_at(p, 2), "ref");
+	EXPECT_THROW(stringlist_at(p, 3), std::out_of_range);
+
+	set(p, uint32_t{1});
+	EXPECT_THROW(stringlist_count(p), std::invalid_argument);
+	EXPECT_THROW(stringlist_index(p, "clk"), std::invalid_argument);
+	EXPECT_THROW(stringlist_at(p, 0), std::invalid_argument);
+}
+
+TEST(property, as_be_span)
+{
+	const auto &f{fdt::load("properties.dtb")};
+
+	const auto &s{as_be_span<uint32_t>(get_property(f, "/property-32"))};
+	EXPECT_EQ(s.size(), 8u);
+	EXPECT_EQ(s[1], 0x05060708u);
+	EXPECT_EQ(*(s.begin() + 7), 0x1d1e1f20u);
+	EXPECT_EQ(s.end() - s.begin(), 8);
+	EXPECT_TRUE(equal(s, as_array<uint32_t>(get_property(f, "/property-32"))));
+
+	using T = std::pair<uint32_t, uint64_t>;
+	const auto &st{as_be_span<T>(get_property(f, "/property-24"))};
+	const std::array<T, 2> val{T{0x01020304, 0x05060708090a0b0c},
+				   T{0x0d0e0f10, 0x1112131415161718}};
+	EXPECT_TRUE(equal(st, val));
+
+	EXPECT_THROW(as_be_span<uint32_t>(get_property(f, "/property-3")), std::invalid_argument);
+	EXPECT_THROW(as_be_span<uint32_t>(get_property(f, "/property-empty")), std::invalid_argument);
+
+	/* values are decoded on access, so only an input iterator in C++17 */
+	using I = fdt::be_span<uint32_t>::iterator;
+	static_assert(std::random_access_iterator<I>);
+	static_assert(std::is_same_v<std::iterator_traits<I>::iterator_category,
+				     std::input_iterator_tag>);
+}
+
+TEST(property, as_array_into)
+{
+	fdt::fdt f;
+	auto &p{add_property(root(f), "test")};
+
+	std::vector<uint32_t> v(1003);
+	for (size_t i{0}; i != size(v); ++i)
+		v[i] = static_cast<uint32_t>(i * 0x01010101);
+	set_array<uint32_t>(p, v);
+
+	std::vector<uint32_t> o(1024);
+	const auto &r{as_array_into<uint32_t>(p, o)};
+	EXPECT_EQ(data(r), data(o));
+	EXPECT_TRUE(equal(r, v));
+	std::vector<uint64_t> o64(size(v) / 2 + 1);
+	EXPECT_THROW(as_array_into<uint64_t>(p, o64), std::invalid_argument);
+	std::vector<uint32_t> small(10);
+	EXPECT_THROW(as_array_into<uint32_t>(p, small), std::invalid_argument);
+
+	/* every width, with vector and scalar tails */
+	std::vector<uint16_t> v16(37);
+	std::vector<uint64_t> v64(37);
+	for (size_t i{0}; i != size(v16); ++i) {
+		v16[i] = static_cast<uint16_t>(i * 0x0102);
+		v64[i] = i * 0x0102030405060708;
+	}
+	std::vector<uint16_t> o16(size(v16));
+	set_array<uint16_t>(p, v16);
+	EXPECT_TRUE(equal(as_array_into<uint16_t>(p, o16), v16));
+	std::vector<uint64_t> o64b(size(v64));
+	set_array<uint64_t>(p, v64);
+	EXPECT_TRUE(equal(as_array_into<uint64_t>(p, o64b), v64));
+
+	using T = std::pair<uint32_t, uint64_t>;
+	const std::array<T, 3> val{T{1, 2}, T{3, 4}, T{5, 6}};
+	set_array<T>(p, val);
+	std::array<T, 3> ot;
+	EXPECT_TRUE(equal(as_array_into<T>(p, ot), val));
+}
+
 TEST(property, as_bytes)
 {
 	const auto &f{fdt::load("properties.dtb")};
@@ -1376,6 +1617,8 @@ TEST(node, name)
 	EXPECT_THROW(add_node(root(f), "this-name-is-longer-than-the-31-character-limit"), std::invalid_argument);
 	EXPECT_THROW(add_node(root(f), "!-is-not-allowed"), std::invalid_argument);
 	EXPECT_THROW(add_node(root(f), "valid@!-is-not-allowed"), std::invalid_argument);
+	EXPECT_THROW(add_node(root(f), "#-is-not-allowed"), std::invalid_argument);
+	EXPECT_THROW(add_node(root(f), "\x80-is-not-allowed"), std::invalid_argument);
 
 	auto &n{add_node(root(f), "node-name@unit-address")};
 
@@ -1444,12 +1687,232 @@ TEST(node, subnodes)
 	EXPECT_EQ(i, nodes.size());
 }
 
+TEST(node, preorder)
+{
+	fdt::fdt f;
+	auto &r{root(f)};
+	add_property(r, "a");
+	auto &b{add_node(r, "b")};
+	add_property(b, "c");
+	add_node(b, "d");
+	add_node(r, "e");
+
+	auto walk = [](auto &&w, bool skip_b = false) {
+		std::vector<std::pair<std::string_view, size_t>> v;
+		for (auto it{w.begin()}; it != w.end(); ++it) {
+			const auto &[p, depth] = *it;
+			v.emplace_back(name(p), depth);
+			if constexpr (requires { it.skip(); })
+				if (skip_b && name(p) == "b")
+					it.skip();
+		}
+		return v;
+	};
+	using V = std::vector<std::pair<std::string_view, size_t>>;
+	EXPECT_EQ(walk(preorder(r)),
+		  (V{{"", 0}, {"a", 1}, {"b", 1}, {"c", 2}, {"d", 2}, {"e", 1}}));
+	EXPECT_EQ(walk(preorder(r), true),
+		  (V{{"", 0}, {"a", 1}, {"b", 1}, {"e", 1}}));
+	EXPECT_EQ(walk(postorder(std::as_const(r))),
+		  (V{{"a", 1}, {"c", 2}, {"d", 2}, {"b", 1}, {"e", 1}, {"", 0}}));
+	EXPECT_EQ(walk(preorder(b)), (V{{"b", 0}, {"c", 1}, {"d", 1}}));
+	EXPECT_EQ(walk(postorder(get_node(f, "/e"))), (V{{"e", 0}}));
+}
+
+TEST(node, deep)
+{
+	/* deep trees must not overflow the stack */
+	constexpr size_t depth{100000};
+	std::optional<fdt::fdt> f{std::in_place};
+	fdt::node *n{&root(*f)};
+	for (size_t i{0}; i != depth; ++i) {
+		add_property(*n, "depth", uint32_t(i));
+		n = &add_node(*n, "n");
+	}
+	const auto &l{fdt::load(save(*f))};
+	EXPECT_TRUE(*f == l);
+	EXPECT_TRUE(clone(l) == *f);
+	size_t nodes{0};
+	for (const auto &[p, d] : postorder(root(l)))
+		nodes += is_node(p);
+	EXPECT_EQ(nodes, depth + 1);
+	f.reset();
+}
+
+TEST(node, parallel_for_each_node)
+{
+	fdt::fdt f;
+	std::vector<fdt::node *> level{&root(f)};
+	for (int d{0}; d != 4; ++d) {
+		std::vector<fdt::node *> next;
+		for (auto n : level)
+			for (int i{0}; i != 8; ++i)
+				next.push_back(&add_node(*n, "n@" + std::to_string(i)));
+		level = std::move(next);
+	}
+
+	for (const auto threads : {0u, 1u, 2u, 7u}) {
+		std::mutex lock;
+		std::set<const fdt::node *> seen;
+		size_t calls{0};
+		parallel_for_each_node(f, [&](const fdt::node &n) {
+			std::lock_guard l{lock};
+			seen.insert(&n);
+			++calls;
+		}, threads);
+		EXPECT_EQ(calls, 1u + 8 + 64 + 512 + 4096);
+		EXPECT_EQ(size(seen), calls);
+	}
+
+	EXPECT_THROW(parallel_for_each_node(f, [](const fdt::node &n) {
+		if (name(n) == "n@3")
+			throw std::runtime_error{"fail"};
+	}, 4), std::runtime_error);
+}
+
+TEST(node, reg)
+{
+	using range = std::tuple<uint32_t, uint64_t, uint32_t>;
+	using cells = std::pair<uint32_t, uint32_t>;
+	fdt::fdt f;
+	auto &r{root(f)};
+	add_property(r, "#address-cells", uint32_t{2});
+	add_property(r, "#size-cells", uint32_t{2});
+	set_array<std::pair<uint64_t, uint64_t>>(
+		add_property(add_node(r, "memory@80000000"), "reg"),
+		std::array{std::pair<uint64_t, uint64_t>{0x80000000, 0x40000000}});
+
+	auto &soc{add_node(r, "soc")};
+	add_property(soc, "#address-cells", uint32_t{1});
+	add_property(soc, "#size-cells", uint32_t{1});
+	auto &ranges{add_property(soc, "ranges")};
+	set_array<range>(ranges, std::array{range{0x0, 0x100000000, 0x10000000},
+					    range{0x40000000, 0x40000000, 0x1000}});
+	auto &uart{add_node(soc, "uart@100")};
+	set_array<cells>(add_property(uart, "reg"),
+			 std::array{cells{0x100, 0x20}, cells{0x40000010, 0x10}});
+	auto &bus{add_node(soc, "bus")};
+	add_property(bus, "#address-cells", uint32_t{1});
+	add_property(bus, "#size-cells", uint32_t{1});
+	add_property(bus, "ranges");
+	add_property(add_node(bus, "dev@200"), "reg", uint64_t{0x0000020000000004});
+	auto &i2c{add_node(soc, "i2c@1000")};
+	add_property(add_node(i2c, "eeprom@50"), "reg", uint64_t{0x0000005000000001});
+
+	EXPECT_EQ(reg(get_node(f, "/memory@80000000")),
+		  (std::vector<fdt::region>{{0x80000000, 0x40000000}}));
+	EXPECT_EQ(reg(uart), (std::vector<fdt::region>{{0x100000100, 0x20},
+							{0x40000010, 0x10}}));
+	EXPECT_EQ(reg(get_node(f, "/soc/bus/dev@200")),
+		  (std::vector<fdt::region>{{0x100000200, 4}}));
+	EXPECT_EQ(translate_address(soc, 0x40000fff), 0x40000fffu);
+
+	/* span overload only writes if regions fit */
+	std::array<fdt::region, 1> one{};
+	EXPECT_EQ(reg(uart, one), 2u);
+	EXPECT_EQ(one[0], (fdt::region{0, 0}));
+
+	EXPECT_THROW(reg(get_node(f, "/soc/i2c@1000/eeprom@50")), std::invalid_argument);
+	EXPECT_THROW(translate_address(soc, 0x40001000), std::invalid_argument);
+	EXPECT_THROW(reg(soc), std::invalid_argument);
+	EXPECT_THROW(reg(r), std::invalid_argument);
+
+	/* cached ranges follow modifications */
+	set_array<range>(ranges, std::array{range{0x0, 0x200000000, 0x10000000}});
+	EXPECT_EQ(reg(get_node(f, "/soc/bus/dev@200")),
+		  (std::vector<fdt::region>{{0x200000200, 4}}));
+	set(get_property(soc, "#size-cells"), uint32_t{2});
+	EXPECT_THROW(reg(uart), std::invalid_argument);
+}
+
+TEST(node, interrupts)
+{
+	auto cells = [](fdt::property &p, std::initializer_list<uint32_t> v) {
+		set_array<uint32_t>(p, std::span{v.begin(), v.size()});
+	};
+	auto spec = [](const fdt::interrupt &i) {
+		return std::vector<uint32_t>{i.specifier};
+	};
+	fdt::fdt f;
+	auto &r{root(f)};
+	auto &intc{add_node(r, "interrupt-controller@0")};
+	add_property(intc, "interrupt-controller");
+	add_property(intc, "#interrupt-cells", uint32_t{3});
+	add_property(intc, "phandle", uint32_t{1});
+	auto &gpio{add_node(r, "gpio")};
+	add_property(gpio, "interrupt-controller");
+	add_property(gpio, "#interrupt-cells", uint32_t{2});
+	add_property(gpio, "phandle", uint32_t{2});
+
+	auto &soc{add_node(r, "soc")};
+	add_property(soc, "interrupt-parent", uint32_t{1});
+	auto &uart{add_node(soc, "uart@100")};
+	cells(add_property(uart, "interrupts"), {0, 5, 4, 0, 6, 4});
+	auto &key{add_node(soc, "key")};
+	cells(add_property(key, "interrupts-extended"), {2, 7, 1, 1, 0, 9, 4});
+
+	auto &pcie{add_node(r, "pcie@1000")};
+	add_property(pcie, "#address-cells", uint32_t{3});
+	add_property(pcie, "#size-cells", uint32_t{2});
+	add_property(pcie, "#interrupt-cells", uint32_t{1});
+	cells(add_property(pcie, "interrupt-map-mask"), {0x1800, 0, 0, 7});
+	auto &map{add_property(pcie, "interrupt-map")};
+	cells(map, {0x0000, 0, 0, 1, 1, 0, 100, 4,
+		    0x0000, 0, 0, 2, 1, 0, 101, 4,
+		    0x0800, 0, 0, 1, 1, 0, 101, 4,
+		    0x0800, 0, 0, 2, 2, 3, 1});
+	auto &dev{add_node(pcie, "dev@1,0")};
+	cells(add_property(dev, "reg"), {0x0800, 0, 0, 0, 0});
+	cells(add_property(dev, "interrupts"), {1, 2});
+
+	const auto &ui{interrupts(uart)};
+	ASSERT_EQ(size(ui), 2u);
+	EXPECT_EQ(&ui[0].controller.get(), &intc);
+	EXPECT_EQ(spec(ui[0]), (std::vector<uint32_t>{0, 5, 4}));
+	EXPECT_EQ(spec(ui[1]), (std::vector<uint32_t>{0, 6, 4}));
+
+	const auto &ki{interrupts(key)};
+	ASSERT_EQ(size(ki), 2u);
+	EXPECT_EQ(&ki[0].controller.get(), &gpio);
+	EXPECT_EQ(spec(ki[0]), (std::vector<uint32_t>{7, 1}));
+	EXPECT_EQ(&ki[1].controller.get(), &intc);
+	EXPECT_EQ(spec(ki[1]), (std::vector<uint32_t>{0, 9, 4}));
+
+	const auto &di{interrupts(dev)};
+	ASSERT_EQ(size(di), 2u);
+	EXPECT_EQ(&di[0].controller.get(), &intc);
+	EXPECT_EQ(spec(di[0]), (std::vector<uint32_t>{0, 101, 4}));
+	EXPECT_EQ(&di[1].controller.get(), &gpio);
+	EXPECT_EQ(spec(di[1]), (std::vector<uint32_t>{3, 1}));
+
+	/* device behind a bridge in slot 1 using INTA */
+	const std::array<uint32_t, 3> ua{0, 0, 0};
+	const std::array<uint32_t, 1> pin{fdt::pci_swizzle(1, 1)};
+	EXPECT_EQ(spec(map_interrupt(pcie, ua, pin)), (std::vector<uint32_t>{0, 101, 4}));
+	const std::array<uint32_t, 1> intd{4};
+	EXPECT_THROW(map_interrupt(pcie, ua, intd), std::invalid_argument);
+
+	EXPECT_TRUE(interrupts(soc).empty());
+	EXPECT_EQ(&find_phandle(f, 2)->get(), &gpio);
+	EXPECT_FALSE(find_phandle(f, 3).has_value());
+
+	/* cached map follows modifications */
+	cells(map, {0x0800, 0, 0, 1, 1, 0, 200, 4,
+		    0x0800, 0, 0, 2, 2, 3, 1});
+	EXPECT_EQ(spec(interrupts(dev)[0]), (std::vector<uint32_t>{0, 200, 4}));
+	set(get_property(soc, "interrupt-parent"), uint32_t{3});
+	EXPECT_THROW(interrupts(uart), std::invalid_argument);
+}
+
 TEST(property, name)
 {
 	fdt::fdt f;
 
 	EXPECT_THROW(add_property(root(f), ""), std::invalid_argument);
 	EXPECT_THROW(add_property(root(f), "this-name-is-longer-than-the-31-character-limit"), std::invalid_argument);
+	EXPECT_THROW(add_property(root(f), "@-is-not-allowed"), std::invalid_argument);
+	EXPECT_THROW(add_property(root(f), "\x80-is-not-allowed"), std::invalid_argument);
+	EXPECT_NO_THROW(add_property(root(f), "#?,._+-are-allowed"));
 
 	auto &p{add_property(root(f), "property-name")};
 
@@ -1520,6 +1983,106 @@ TEST(node, find)
 	EXPECT_FALSE(find(root(fc), "x").has_value());
 }
 
+TEST(node, find_node_name)
+{
+	fdt::fdt f;
+	auto &r{root(f)};
+	add_node(r, "a-b");
+	auto &a1{add_node(r, "a@1")};
+	auto &b1{add_node(r, "b@1")};
+	auto &b10{add_node(r, "b@10")};
+	add_node(r, "b,c@1");
+	add_node(r, "ba@1");
+	auto &c{add_node(r, "c")};
+	auto &c1{add_node(r, "c@1")};
+	add_property(r, "d");
+
+	/* names sorting between "a" and "a@1" don't hide the match */
+	EXPECT_EQ(&get_node(r, "a"), &a1);
+	EXPECT_EQ(&get_node(r, "a@1"), &a1);
+	EXPECT_THROW(find(r, "b"), std::invalid_argument);
+	EXPECT_EQ(try_find(r, "b").error(), fdt::errc::ambiguous_path);
+	EXPECT_EQ(&get_node(r, "b@10"), &b10);
+	/* an exact match is preferred */
+	EXPECT_EQ(&get_node(r, "c"), &c);
+	EXPECT_FALSE(find(r, "e").has_value());
+	EXPECT_FALSE(find(r, "a@2").has_value());
+
+	std::vector<const fdt::node *> v;
+	for (auto &n : subnodes(r, "b"))
+		v.push_back(&n);
+	EXPECT_EQ(v, (std::vector<const fdt::node *>{&b1, &b10}));
+	v.clear();
+	for (auto &n : subnodes(std::as_const(r), "c"))
+		v.push_back(&n);
+	EXPECT_EQ(v, (std::vector<const fdt::node *>{&c, &c1}));
+	EXPECT_TRUE(subnodes(r, "d").empty());
+	EXPECT_TRUE(subnodes(r, "e").empty());
+
+	/* exact name lookups are not affected by node-name matches */
+	add_node(b1, "phandle@1");
+	add_node(b1, "phandle@2");
+	EXPECT_FALSE(find_phandle(f, 1).has_value());
+}
+
+TEST(node, bind)
+{
+	struct config {
+		uint32_t reg{0};
+		uint32_t speed{115200};
+		std::optional<uint64_t> freq{1};
+		std::array<uint32_t, 2> range{};
+		std::vector<uint32_t> cells;
+		std::string_view status;
+		std::string model;
+		bool coherent{true};
+	};
+	const fdt::binding<config> b{
+		fdt::required_field("reg", &config::reg),
+		fdt::field("current-speed", &config::speed),
+		fdt::field("clock-frequency", &config::freq),
+		fdt::field("ranges", &config::range),
+		fdt::field("cells", &config::cells),
+		fdt::field("status", &config::status),
+		fdt::field("model", &config::model),
+		fdt::field("dma-coherent", &config::coherent),
+	};
+
+	auto f{fdt::load("path.dtb")};
+	auto &n{get_node(f, "/l1@1")};
+	add_property(n, "ranges", std::array<uint32_t, 2>{1, 2});
+	add_property(n, "cells", std::array<uint32_t, 3>{3, 4, 5});
+	add_property(n, "status", "okay");
+	add_property(n, "model", "vendor,board");
+
+	config c;
+	bind(std::as_const(n), b, c);
+	EXPECT_EQ(c.reg, 1u);
+	EXPECT_EQ(c.speed, 115200u);
+	EXPECT_FALSE(c.freq.has_value());
+	EXPECT_EQ(c.range, (std::array<uint32_t, 2>{1, 2}));
+	EXPECT_EQ(c.cells, (std::vector<uint32_t>{3, 4, 5}));
+	EXPECT_EQ(c.status, "okay");
+	EXPECT_EQ(c.model, "vendor,board");
+	EXPECT_FALSE(c.coherent);
+
+	add_property(n, "clock-frequency", uint64_t{50000000});
+	add_property(n, "current-speed", uint32_t{9600});
+	add_property(n, "dma-coherent");
+	bind(n, b, c);
+	EXPECT_EQ(c.freq, 50000000u);
+	EXPECT_EQ(c.speed, 9600u);
+	EXPECT_TRUE(c.coherent);
+
+	/* conversion errors and missing required properties */
+	set(get_property(n, "current-speed"), "fast");
+	EXPECT_THROW(bind(n, b, c), std::invalid_argument);
+	EXPECT_THROW(bind(root(f), b, c), std::invalid_argument);
+	EXPECT_THROW((fdt::binding<config>{fdt::field("reg", &config::reg),
+					   fdt::field("reg", &config::speed)}),
+		     std::invalid_argument);
+}
+
 TEST(node, get_node)
 {
 	auto f{fdt::load("path.dtb")};
@@ -1570,7 +2133,7 @@ TEST(fdt, find)
 	EXPECT_TRUE(is_node(*find(f, "/l1@1/l2")));
 	EXPECT_EQ(as<uint32_t>(as_property(*find(f, "/l1@1/l2/l1#1-l2#1-prop"))), 11u);
 	EXPECT_THROW(find(f, "/l1@1//l2"), std::invalid_argument);
-	EXPECT_THROW(find(f, "x"), std::invalid_argument);
+	EXPECT_FALSE(find(f, "x").has_value());
 	EXPECT_FALSE(find(f, "/x").has_value());
 
 	/* find(fdt node &) */
@@ -1580,7 +2143,7 @@ TEST(fdt, find)
 	EXPECT_TRUE(is_node(*find(fc, "/l1@1/l2")));
 	EXPECT_EQ(as<uint32_t>(as_property(*find(fc, "/l1@1/l2/l1#1-l2#1-prop"))), 11u);
 	EXPECT_THROW(find(fc, "/l1@1//l2"), std::invalid_argument);
-	EXPECT_THROW(find(fc, "x"), std::invalid_argument);
+	EXPECT_FALSE(find(fc, "x").has_value());
 	EXPECT_FALSE(find(fc, "/x").has_value());
 }
 
@@ -1591,13 +2154,13 @@ TEST(fdt, get_node)
 
 	/* get_node(fdt &) */
 	EXPECT_EQ(name(get_node(f, "/l1@2/l2@1")), "l2@1");
-	EXPECT_THROW(get_node(f, "x"), std::invalid_argument);
+	EXPECT_THROW(get_node(f, "x"), std::bad_optional_access);
 	EXPECT_THROW(get_node(f, "/x"), std::bad_optional_access);
 	EXPECT_THROW(get_node(f, "/l1@2/l2@1/l1#2-l2#1-prop"), std::bad_cast);
 
 	/* get_node(const fdt &) */
 	EXPECT_EQ(name(get_node(cf, "/l1@2/l2@1")), "l2@1");
-	EXPECT_THROW(get_node(cf, "x"), std::invalid_argument);
+	EXPECT_THROW(get_node(cf, "x"), std::bad_optional_access);
 	EXPECT_THROW(get_node(cf, "/x"), std::bad_optional_access);
 	EXPECT_THROW(get_node(cf, "/l1@2/l2@1/l1#2-l2#1-prop"), std::bad_cast);
 }
@@ -1609,13 +2172,13 @@ TEST(fdt, get_property)
 
 	/* get_property(fdt &) */
 	EXPECT_EQ(name(get_property(f, "/l1@1/l2@1/l1#1-l2#1-prop")), "l1#1-l2#1-prop");
-	EXPECT_THROW(get_property(f, "x"), std::invalid_argument);
+	EXPECT_THROW(get_property(f, "x"), std::bad_optional_access);
 	EXPECT_THROW(get_property(f, "/x"), std::bad_optional_access);
 	EXPECT_THROW(get_property(f, "/l1@1"), std::bad_cast);
 
 	/* get_property(const fdt &) */
 	EXPECT_EQ(name(get_property(cf, "/l1@1/l2@1/l1#1-l2#1-prop")), "l1#1-l2#1-prop");
-	EXPECT_THROW(get_property(cf, "x"), std::invalid_argument);
+	EXPECT_THROW(get_property(cf, "x"), std::bad_optional_access);
 	EXPECT_THROW(get_property(cf, "/x"), std::bad_optional_access);
 	EXPECT_THROW(get_property(cf, "/l1@1"), std::bad_cast);
 }
@@ -1640,3 +2203,822 @@ TEST(fdt, save_load)
 	EXPECT_EQ(f1, f2);
 	EXPECT_EQ(f1, f3);
 }
+
+TEST(fdt, load_invalid_name)
+{
+	/* fdt_check_full accepts these, load must not */
+	auto corrupt = [](std::string_view from, std::string_view to) {
+		fdt::fdt f;
+		add_property(add_node(root(f), "node-name"), "prop-name", 1u);
+		auto b{save(f)};
+		const std::string_view s{reinterpret_cast<const char *>(data(b)),
+					 size(b)};
+		std::memcpy(data(b) + s.find(from), data(to), size(to));
+		return b;
+	};
+	EXPECT_NO_THROW(fdt::load(corrupt("node-name", "node-name")));
+	EXPECT_THROW(fdt::load(corrupt("node-name", "node!name")),
+		     std::invalid_argument);
+	EXPECT_THROW(fdt::load(corrupt("prop-name", "prop name")),
+		     std::invalid_argument);
+}
+
+TEST(fdt, clone)
+{
+	const auto &f1{fdt::load("path.dtb")};
+	auto f2{clone(f1)};
+
+	EXPECT_EQ(f1, f2);
+
+	/* property values are shared until modified */
+	const auto &p1{get_property(f1, "/l1@1/l2@1/l1#1-l2#1-prop")};
+	auto &p2{get_property(f2, "/l1@1/l2@1/l1#1-l2#1-prop")};
+	EXPECT_EQ(data(as_bytes(p1)), data(as_bytes(p2)));
+
+	set(p2, uint32_t{12});
+	EXPECT_NE(data(as_bytes(p1)), data(as_bytes(p2)));
+	EXPECT_EQ(as<uint32_t>(p1), 11u);
+	EXPECT_EQ(as<uint32_t>(p2), 12u);
+	EXPECT_NE(f1, f2);
+
+	add_node(get_node(f2, "/l1@2"), "l2@2");
+	EXPECT_FALSE(contains(f1, "/l1@2/l2@2"));
+}
+
+/*
+ * counting_resource - memory resource which counts outstanding bytes
+ */
+class counting_resource : public std::pmr::memory_resource {
+public:
+	explicit counting_resource(std::pmr::memory_resource *upstream =
+				   std::pmr::new_delete_resource())
+	: upstream_{upstream}
+	{ }
+
+	size_t allocations{0};
+	size_t outstanding{0};
+
+private:
+	void *do_allocate(size_t n, size_t a) override
+	{
+		++allocations;
+		outstanding += n;
+		return upstream_->allocate(n, a);
+	}
+
+	void do_deallocate(void *p, size_t n, size_t a) override
+	{
+		outstanding -= n;
+		upstream_->deallocate(p, n, a);
+	}
+
+	bool do_is_equal(const memory_resource &o) const noexcept override
+	{
+		return this == &o;
+	}
+
+	std::pmr::memory_resource *upstream_;
+};
+
+TEST(fdt, memory_resource)
+{
+	counting_resource r;
+	{
+		auto f{fdt::load("static.dtb", &r)};
+		EXPECT_EQ(resource(f), &r);
+		EXPECT_EQ(resource(get_node(f, "/soc/serial@1000")), &r);
+		EXPECT_EQ(f, fdt::load("static.dtb"));
+
+		/* nodes, long names and values come from the resource */
+		auto n{r.allocations};
+		auto &l{add_node(root(f), "a-node-with-a-long-name")};
+		add_property(l, "a-property-with-a-long-name", "value");
+		EXPECT_GE(r.allocations, n + 4);
+
+		/* as do lookup caches */
+		n = r.allocations;
+		EXPECT_EQ(reg(get_node(f, "/soc/serial@1000")),
+			  (std::vector<fdt::region>{{0x40001000, 0x100}}));
+		EXPECT_TRUE(find_label(std::as_const(f), "uart0"));
+		EXPECT_GT(r.allocations, n);
+
+		auto c{clone(f)};
+		EXPECT_EQ(resource(c), &r);
+		EXPECT_EQ(c, f);
+		EXPECT_EQ(resource(clone(f, std::pmr::get_default_resource())),
+			  std::pmr::get_default_resource());
+	}
+	EXPECT_EQ(r.outstanding, 0u);
+
+	/* an arena with no upstream is enough for a whole tree */
+	std::array<std::byte, 16384> b;
+	std::pmr::monotonic_buffer_resource a{data(b), size(b),
+					      std::pmr::null_memory_resource()};
+	const auto &f{fdt::load("static.dtb", &a)};
+	EXPECT_EQ(f, fdt::load("static.dtb"));
+	EXPECT_EQ(reg(get_node(f, "/soc/serial@2000")).size(), 2u);
+
+	/* string setters write their values straight into the resource */
+	std::array<std::byte, 16384> b2;
+	std::pmr::monotonic_buffer_resource a2{data(b2), size(b2),
+					       std::pmr::null_memory_resource()};
+	counting_resource cr{&a2};
+	{
+		fdt::fdt t{&cr};
+		auto &l{add_node(add_node(root(t), "soc"), "a-node-with-a-long-name")};
+		add_property(l, "a-property-with-a-long-name", "value");
+		auto &p1{add_property(l, "p1")};
+		auto &p2{add_property(l, "p2")};
+		auto n{cr.allocations};
+		set(p1, std::string_view{"value", 3});
+		set(p2, std::vector<std::string_view>{"ab", "", "cd"});
+		EXPECT_EQ(cr.allocations, n + 2);
+		auto &p3{add_property(l, "p3", "abc")};
+		set(p3, std::vector<std::string_view>{"x", as_string(p3)});
+		auto c{clone(t)};
+		EXPECT_EQ(c, t);
+		EXPECT_EQ(as_string(get_property(c, "/soc/a-node-with-a-long-name/p1")),
+			  "val");
+		EXPECT_TRUE(equal(as_stringlist(get_property(c, "/soc/a-node-with-a-long-name/p2")),
+				  std::vector<std::string_view>{"ab", "cd"}));
+		EXPECT_TRUE(equal(as_stringlist(p3),
+				  std::vector<std::string_view>{"x", "abc"}));
+	}
+	EXPECT_EQ(cr.outstanding, 0u);
+}
+
+TEST(fdt, clone_resource)
+{
+	/* a clone into another resource outlives the original and its arena */
+	std::optional<fdt::fdt> c;
+	{
+		std::array<std::byte, 16384> b;
+		std::pmr::monotonic_buffer_resource a{data(b), size(b),
+			std::pmr::null_memory_resource()};
+		{
+			const auto &f{fdt::load("static.dtb", &a)};
+			c.emplace(clone(f, std::pmr::new_delete_resource()));
+		}
+		a.release();
+		std::fill(begin(b), end(b), 0xa5_b);
+	}
+	EXPECT_EQ(resource(*c), std::pmr::new_delete_resource());
+	EXPECT_EQ(*c, fdt::load("static.dtb"));
+	set(get_property(*c, "/chosen/bootargs"), "console=ttyS1");
+	c.reset();
+}
+
+TEST(fdt, apply_overlay)
+{
+	/* base tree as compiled by dtc -@ */
+	fdt::fdt b;
+	auto &soc{add_node(root(b), "soc")};
+	auto &uart{add_node(soc, "uart@1000")};
+	add_property(uart, "phandle", uint32_t{1});
+	add_property(uart, "status", "disabled");
+	add_property(add_node(soc, "intc"), "phandle", uint32_t{2});
+	auto &bs{add_node(root(b), "__symbols__")};
+	add_property(bs, "uart0", "/soc/uart@1000");
+	add_property(bs, "intc", "/soc/intc");
+
+	/* overlay as compiled by dtc -@ */
+	fdt::fdt o;
+	auto &f0{add_node(root(o), "fragment@0")};
+	add_property(f0, "target", uint32_t{0xffffffff});
+	auto &f0o{add_node(f0, "__overlay__")};
+	add_property(f0o, "status", "okay");
+	add_property(f0o, "ref-local", uint32_t{1});
+	add_property(add_node(f0o, "child"), "phandle", uint32_t{1});
+	auto &f1{add_node(root(o), "fragment@1")};
+	add_property(f1, "target-path", "/soc");
+	auto &f1n{add_node(add_node(f1, "__overlay__"), "new@2000")};
+	add_property(f1n, "interrupt-parent", uint32_t{0xffffffff});
+	add_property(f1n, "buddy", uint32_t{1});
+	auto &fx{add_node(root(o), "__fixups__")};
+	add_property(fx, "uart0", "/fragment@0:target:0");
+	add_property(fx, "intc", "/fragment@1/__overlay__/new@2000:interrupt-parent:0");
+	auto &lf{add_node(root(o), "__local_fixups__")};
+	add_property(add_node(add_node(lf, "fragment@0"), "__overlay__"), "ref-local", uint32_t{0});
+	add_property(add_node(add_node(add_node(lf, "fragment@1"), "__overlay__"), "new@2000"), "buddy", uint32_t{0});
+	add_property(add_node(root(o), "__symbols__"), "mychild", "/fragment@0/__overlay__/child");
+
+	const auto &oc{clone(o)};
+	apply_overlay(b, o);
+
+	EXPECT_EQ(o, oc);
+	EXPECT_EQ(as_string(get_property(b, "/soc/uart@1000/status")), "okay");
+	EXPECT_EQ(as<uint32_t>(get_property(b, "/soc/uart@1000/child/phandle")), 3u);
+	EXPECT_EQ(as<uint32_t>(get_property(b, "/soc/uart@1000/ref-local")), 3u);
+	EXPECT_EQ(as<uint32_t>(get_property(b, "/soc/new@2000/interrupt-parent")), 2u);
+	EXPECT_EQ(as<uint32_t>(get_property(b, "/soc/new@2000/buddy")), 3u);
+	EXPECT_EQ(as_string(get_property(b, "/__symbols__/mychild")), "/soc/uart@1000/child");
+	EXPECT_FALSE(contains(b, "/fragment@0"));
+
+	/* unresolvable label */
+	fdt::fdt b2;
+	add_node(root(b2), "__symbols__");
+	EXPECT_THROW(apply_overlay(b2, o), std::invalid_argument);
+
+	/* local fixup of a missing property */
+	add_property(get_node(lf, "fragment@1/__overlay__/new@2000"), "missing", uint32_t{0});
+	EXPECT_THROW(apply_overlay(b2, o), std::invalid_argument);
+}
+
+TEST(fdt, aliases)
+{
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+	auto &a{add_node(root(f), "aliases")};
+	add_property(a, "l1", "/l1@1");
+	add_property(add_node(root(f), "__symbols__"), "second", "/l1@2/l2@1");
+
+	/* find_alias, find_label */
+	EXPECT_EQ(&find_alias(f, "l1")->get(), &get_node(f, "/l1@1"));
+	EXPECT_EQ(&find_label(fc, "second")->get(), &get_node(f, "/l1@2/l2@1"));
+	EXPECT_FALSE(find_alias(f, "second").has_value());
+	EXPECT_FALSE(find_label(fc, "l1").has_value());
+
+	/* paths starting with alias or label */
+	EXPECT_EQ(&get_node(f, "l1"), &get_node(f, "/l1@1"));
+	EXPECT_EQ(as<uint32_t>(get_property(fc, "l1/l2/l1#1-l2#1-prop")), 11u);
+	EXPECT_EQ(as<uint32_t>(get_property(f, "&second/reg")), 1u);
+	EXPECT_FALSE(find(f, "l2").has_value());
+	EXPECT_FALSE(find(fc, "&l1").has_value());
+	EXPECT_THROW(get_node(f, "l2/x"), std::bad_optional_access);
+	EXPECT_THROW(find(f, "l1//reg"), std::invalid_argument);
+
+	/* indexes follow modifications */
+	set(get_property(f, "/aliases/l1"), "/l1@2");
+	add_property(a, "l2", "/l1@1/l2@1");
+	EXPECT_EQ(&get_node(f, "l1"), &get_node(f, "/l1@2"));
+	EXPECT_EQ(&get_node(fc, "l2"), &get_node(f, "/l1@1/l2@1"));
+}
+
+TEST(fdt, path_handle)
+{
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+	const fdt::path_handle h{"/l1@1/l2/reg"};
+	auto &reg{get_property(f, "/l1@1/l2@1/reg")};
+
+	/* repeated lookups reuse the cached result */
+	EXPECT_EQ(&find(f, h)->get(), &reg);
+	EXPECT_EQ(&find(fc, h)->get(), &reg);
+	EXPECT_THROW(find(root(f), h), std::invalid_argument);
+	const fdt::path_handle nh{"/x"};
+	EXPECT_FALSE(find(fc, nh).has_value());
+	EXPECT_FALSE(find(fc, nh).has_value());
+
+	/* relative to a node */
+	const fdt::path_handle rh{"l2/reg"};
+	auto &l1{get_node(f, "/l1@1")};
+	EXPECT_EQ(&find(l1, rh)->get(), &reg);
+	EXPECT_EQ(&find(std::as_const(l1), rh)->get(), &reg);
+	EXPECT_EQ(&find(get_node(f, "/l1@2"), rh)->get(),
+		  &get_property(f, "/l1@2/l2@1/reg"));
+
+	/* lookups follow modifications */
+	auto &l2{add_node(l1, "l2")};
+	EXPECT_FALSE(find(l1, rh).has_value());
+	auto &r2{add_property(l2, "reg", uint32_t{2})};
+	EXPECT_EQ(&find(l1, rh)->get(), &r2);
+	EXPECT_EQ(&find(f, h)->get(), &r2);
+
+	/* paths starting with alias or label */
+	add_property(add_node(root(f), "aliases"), "l1", "/l1@2");
+	EXPECT_EQ(&find(fc, fdt::path_handle{"l1/l2/reg"})->get(),
+		  &get_property(f, "/l1@2/l2@1/reg"));
+	EXPECT_FALSE(find(f, fdt::path_handle{"x/reg"}).has_value());
+
+	/* handles can be used with many trees */
+	auto f2{fdt::load("path.dtb")};
+	EXPECT_EQ(&find(f2, h)->get(), &get_property(f2, "/l1@1/l2@1/reg"));
+
+	/* and by many threads at once */
+	const std::array<std::pair<const fdt::fdt *, const fdt::piece *>, 2>
+	    expect{{{&f, &r2}, {&f2, &get_property(f2, "/l1@1/l2@1/reg")}}};
+	std::vector<std::thread> t;
+	for (const auto &[tf, tp] : expect)
+		t.emplace_back([&h, tf, tp] {
+			for (int i{0}; i != 1000; ++i)
+				EXPECT_EQ(&find(*tf, h)->get(), tp);
+		});
+	for (auto &th : t)
+		th.join();
+	const auto hc{h};
+	EXPECT_EQ(&find(f2, hc)->get(), &get_property(f2, "/l1@1/l2@1/reg"));
+
+	EXPECT_THROW(fdt::path_handle{"l1//l2"}, std::invalid_argument);
+	EXPECT_THROW(fdt::path_handle{""}, std::invalid_argument);
+	EXPECT_THROW(fdt::path_handle{"/"}, std::invalid_argument);
+}
+
+TEST(fdt, path_literal)
+{
+	using namespace fdt::literals;
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+
+	constexpr auto p{"/l1@1/l2/reg"_fdtpath};
+	static_assert(p.absolute());
+	static_assert(size(p.components()) == 3);
+	static_assert(p.components()[1] == "l2");
+	static_assert(fdt::dtl::valid_path_component("&label", true));
+	static_assert(!fdt::dtl::valid_path_component("&label", false));
+	static_assert(!fdt::dtl::valid_path_component("l1@", false));
+	static_assert(!fdt::dtl::valid_path_component("", false));
+	static_assert(fdt::dtl::valid_path_component(
+	    "a-property-name-of-31-character", false));
+	static_assert(!fdt::dtl::valid_path_component(
+	    "a-property-name-of-32-characters", false));
+	static_assert(fdt::dtl::valid_path_component(
+	    "node@a-unit-address-longer-than-31-characters", false));
+
+	EXPECT_EQ(&get_property(f, p), &get_property(f, "/l1@1/l2@1/reg"));
+	EXPECT_EQ(as<uint32_t>(get_property(fc, "/l1@2/l2@1/l1#2-l2#1-prop"_fdtpath)), 21u);
+	EXPECT_EQ(&get_node(fc, "/l1@2"_fdtpath), &get_node(f, "/l1@2"));
+	EXPECT_EQ(&get_node(get_node(f, "/l1@2"), "l2"_fdtpath),
+		  &get_node(f, "/l1@2/l2@1"));
+	EXPECT_FALSE(find(f, "/x"_fdtpath).has_value());
+	EXPECT_THROW(find(f, "/l1/l2"_fdtpath), std::invalid_argument);
+	EXPECT_THROW(find(root(f), p), std::invalid_argument);
+	EXPECT_THROW(get_node(f, p), std::bad_cast);
+
+	add_property(add_node(root(f), "aliases"), "l1", "/l1@2");
+	EXPECT_EQ(&get_node(fc, "l1/l2"_fdtpath), &get_node(f, "/l1@2/l2@1"));
+}
+
+TEST(fdt, fdtgen)
+{
+	using namespace static_dtb;
+	static_assert(&get_node(root, "soc/serial@1000") == &labels::uart0);
+	static_assert(name(get_node(root, "soc/serial@2000")) == "serial@2000");
+	static_assert(as<uint32_t>(get_property(labels::uart0, "clock-frequency")) == 48000000);
+	static_assert(as_string(get_property(root, "chosen/bootargs")) == "console=ttyS0");
+	static_assert(reg(labels::uart0)[0] == fdt::region{0x40001000, 0x100});
+	static_assert(is_compatible(labels::uart0, "ns16550a"));
+	static_assert(!is_compatible(root, "ns16550a"));
+	static_assert(try_get_node(root, "soc/serial").error() == fdt::errc::ambiguous_path);
+	static_assert(try_get_property(root, "soc/x").error() == fdt::errc::not_found);
+
+	EXPECT_EQ(name(parent(labels::uart0)->get()), "soc");
+	EXPECT_FALSE(parent(root).has_value());
+	EXPECT_THROW(get_node(root, "soc/x"), std::bad_optional_access);
+	EXPECT_THROW(get_node(root, "soc//x"), std::invalid_argument);
+	EXPECT_THROW(get_property(root, "soc/serial/reg"), std::invalid_argument);
+	EXPECT_THROW(as_string(get_property(root, "soc/ranges")), std::invalid_argument);
+
+	/* generated tables match the tree */
+	auto f{fdt::load("static.dtb")};
+	const auto &s{get_node(root, "soc/serial@2000")};
+	const auto &n{get_node(f, "/soc/serial@2000")};
+	EXPECT_TRUE(equal(reg(s), reg(n)));
+	EXPECT_TRUE(equal(as_bytes(get_property(s, "reg")),
+			  as_bytes(get_property(n, "reg"))));
+	EXPECT_EQ(size(subnodes(get_node(root, "soc"))), 2u);
+	EXPECT_EQ(size(properties(s)), 3u);
+}
+
+void
+expect_same(const fdt::static_node &l, const fdt::static_node &r)
+{
+	EXPECT_EQ(name(l), name(r));
+	EXPECT_TRUE(equal(reg(l), reg(r)));
+	EXPECT_TRUE(equal(l.compatible, r.compatible));
+	ASSERT_EQ(size(properties(l)), size(properties(r)));
+	for (size_t i{0}; i != size(properties(l)); ++i) {
+		EXPECT_EQ(name(properties(l)[i]), name(properties(r)[i]));
+		EXPECT_EQ(properties(l)[i].value, properties(r)[i].value);
+	}
+	ASSERT_EQ(size(subnodes(l)), size(subnodes(r)));
+	for (size_t i{0}; i != size(subnodes(l)); ++i) {
+		EXPECT_EQ(&parent(subnodes(l)[i])->get(), &l);
+		expect_same(subnodes(l)[i], subnodes(r)[i]);
+	}
+}
+
+TEST(fdt, static_fdt)
+{
+	static constexpr unsigned char blob[]{
+#include "static.dtb.inc"
+	};
+	constexpr auto &t{fdt::static_fdt<blob>};
+	static_assert(name(get_node(root(t), "soc/serial@1000")) == "serial@1000");
+	static_assert(as<uint32_t>(get_property(root(t), "soc/serial@1000/clock-frequency")) == 48000000);
+	static_assert(as_string(get_property(root(t), "chosen/bootargs")) == "console=ttyS0");
+	static_assert(reg(get_node(root(t), "soc/serial@2000"))[1] == fdt::region{0x40003000, 0x100});
+	static_assert(is_compatible(get_node(root(t), "soc/serial@2000"), "ns16550a"));
+	static_assert(try_get_node(root(t), "soc/serial").error() == fdt::errc::ambiguous_path);
+
+	/* same tables as fdtgen */
+	expect_same(root(t), static_dtb::root);
+}
+
+void
+expect_same(const fdt::static_node &l, fdt::compact_node r)
+{
+	EXPECT_EQ(name(l), name(r));
+	if (!empty(reg(l))) {
+		EXPECT_TRUE(equal(reg(l), reg(r)));
+	}
+	for (const auto &c : l.compatible)
+		EXPECT_TRUE(is_compatible(r, c));
+	ASSERT_EQ(size(properties(l)), properties(r).size());
+	auto rp{properties(r).begin()};
+	for (const auto &p : properties(l)) {
+		EXPECT_EQ(name(p), name(*rp));
+		EXPECT_TRUE(equal(as_bytes(p), as_bytes(*rp)));
+		++rp;
+	}
+	ASSERT_EQ(size(subnodes(l)), subnodes(r).size());
+	auto rs{subnodes(r).begin()};
+	for (const auto &s : subnodes(l)) {
+		EXPECT_TRUE(parent(*rs) == r);
+		expect_same(s, *rs++);
+	}
+}
+
+TEST(fdt, reg_nested_ranges)
+{
+	fdt::fdt f;
+	auto &r{root(f)};
+	add_property(r, "#address-cells", 2u);
+	add_property(r, "#size-cells", 1u);
+	auto &b{add_node(r, "bus")};
+	add_property(b, "#address-cells", 1u);
+	add_property(b, "#size-cells", 1u);
+	add_property(b, "ranges", std::array<uint32_t, 4>{0x0, 0x0, 0x80000000,
+							  0x1000000});
+	add_property(add_node(b, "dev@1000"), "reg",
+		     std::array<uint32_t, 2>{0x1000, 0x100});
+	auto &sb{add_node(b, "sub@100000")};
+	add_property(sb, "#address-cells", 1u);
+	add_property(sb, "#size-cells", 1u);
+	add_property(sb, "ranges", std::array<uint32_t, 3>{0x0, 0x100000,
+							   0x10000});
+	add_property(add_node(sb, "dev@20"), "reg",
+		     std::array<uint32_t, 4>{0x20, 0x10, 0x40, 0x10});
+	auto &i2c{add_node(b, "i2c@2000")};
+	add_property(i2c, "#address-cells", 1u);
+	add_property(i2c, "#size-cells", 0u);
+	add_property(add_node(i2c, "eeprom@50"), "reg", 0x50u);
+	auto &id{add_node(r, "identity")};
+	add_property(id, "#address-cells", 2u);
+	add_property(id, "#size-cells", 1u);
+	add_property(id, "ranges");
+	add_property(add_node(id, "dev@10"), "reg",
+		     std::array<uint32_t, 3>{0x1, 0x10, 0x8});
+
+	EXPECT_EQ(reg(get_node(f, "/bus/sub@100000/dev@20")),
+		  (std::vector<fdt::region>{{0x80100020, 0x10},
+					    {0x80100040, 0x10}}));
+
+	/* the compile time parser, the tree and the tables agree */
+	const auto &blob{save(f)};
+	const auto &t{fdt::dtl::parse_static(
+	    {reinterpret_cast<const char *>(data(blob)), size(blob)})};
+	const auto &c{compact(f)};
+	const auto &z{freeze(f)};
+	std::vector<std::string> paths(size(t.nodes));
+	size_t checked{0};
+	for (size_t i{1}; i != size(t.nodes); ++i) {
+		const auto &e{t.nodes[i]};
+		paths[i] = paths[e.parent] + "/" + std::string{e.name};
+		const auto &n{get_node(f, paths[i])};
+		if (!contains(n, "reg"))
+			continue;
+		const auto rel{paths[i].substr(1)};
+		if (!e.region_count) {
+			EXPECT_THROW(reg(n), std::invalid_argument) << paths[i];
+			EXPECT_THROW(reg(get_node(root(c), rel)),
+				     std::invalid_argument);
+			EXPECT_THROW(reg(get_node(root(z), rel)),
+				     std::invalid_argument);
+			continue;
+		}
+		const std::span<const fdt::region> sr{
+		    data(t.regions) + e.regions, e.region_count};
+		EXPECT_TRUE(equal(sr, reg(n))) << paths[i];
+		EXPECT_TRUE(equal(sr, reg(get_node(root(c), rel))));
+		EXPECT_TRUE(equal(sr, reg(get_node(root(z), rel))));
+		++checked;
+	}
+	EXPECT_EQ(checked, 3u);
+}
+
+TEST(fdt, parse_static_malformed)
+{
+	auto parse = [](const fdt::fdt &f) {
+		const auto &blob{save(f)};
+		return fdt::dtl::parse_static(
+		    {reinterpret_cast<const char *>(data(blob)), size(blob)});
+	};
+	auto tree = [](auto &&edit) {
+		fdt::fdt f;
+		add_property(root(f), "#address-cells", 1u);
+		auto &b{add_node(root(f), "bus")};
+		add_property(b, "#address-cells", 1u);
+		add_property(b, "#size-cells", 1u);
+		add_property(b, "ranges", std::array<uint32_t, 3>{0x0, 0x1000,
+								   0x100});
+		add_property(add_node(b, "dev@10"), "reg",
+			     std::array<uint32_t, 2>{0x10, 0x10});
+		edit(b);
+		return f;
+	};
+
+	/* an address outside the ranges is untranslatable, not malformed */
+	EXPECT_NO_THROW(parse(tree([](fdt::node &b) {
+		set(get_property(b, "dev@10/reg"),
+		    std::array<uint32_t, 2>{0x200, 0x10});
+	})));
+
+	EXPECT_THROW(parse(tree([](fdt::node &b) {
+		set(get_property(b, "#address-cells"), 5u);
+	})), std::invalid_argument);
+	EXPECT_THROW(parse(tree([](fdt::node &b) {
+		set(get_property(b, "#size-cells"), uint64_t{1});
+	})), std::invalid_argument);
+	EXPECT_THROW(parse(tree([](fdt::node &b) {
+		set(get_property(b, "dev@10/reg"), 0x10u);
+	})), std::invalid_argument);
+	EXPECT_THROW(parse(tree([](fdt::node &b) {
+		set(get_property(b, "ranges"), std::array<uint32_t, 2>{0, 0});
+	})), std::invalid_argument);
+
+	/* property name running off the end of the strings block */
+	fdt::fdt f;
+	add_property(root(f), "model", "m");
+	const auto &saved{save(f)};
+	std::string blob{reinterpret_cast<const char *>(data(saved)),
+			 size(saved)};
+	blob.resize(fdt::dtl::static_be32(blob, 12) +
+		    fdt::dtl::static_be32(blob, 32));
+	blob.back() = 'x';
+	for (size_t i{0}; i != 4; ++i)
+		blob[4 + i] = static_cast<char>(size(blob) >> (24 - 8 * i));
+	EXPECT_THROW(fdt::dtl::parse_static(blob), std::invalid_argument);
+}
+
+void
+expect_same(fdt::compact_node l, fdt::compact_node r)
+{
+	EXPECT_EQ(name(l), name(r));
+	const auto &lp{properties(l)};
+	const auto &rp{properties(r)};
+	ASSERT_EQ(lp.size(), rp.size());
+	for (auto li{lp.begin()}, ri{rp.begin()}; li != lp.end(); ++li, ++ri) {
+		EXPECT_EQ(name(*li), name(*ri));
+		EXPECT_TRUE(equal(as_bytes(*li), as_bytes(*ri)));
+	}
+	const auto &ls{subnodes(l)};
+	const auto &rs{subnodes(r)};
+	ASSERT_EQ(ls.size(), rs.size());
+	for (auto li{ls.begin()}, ri{rs.begin()}; li != ls.end(); ++li, ++ri)
+		expect_same(*li, *ri);
+}
+
+TEST(fdt, compact)
+{
+	const auto &f{fdt::load("static.dtb")};
+	auto c{compact(f)};
+	const auto s{get_node(root(c), "soc/serial@1000")};
+	expect_same(static_dtb::root, root(c));
+
+	/* handles survive moving the tables */
+	const auto m{std::move(c)};
+	EXPECT_EQ(name(*parent(s)), "soc");
+	EXPECT_EQ(as<uint32_t>(get_property(s, "clock-frequency")), 48000000u);
+	EXPECT_EQ(as_string(get_property(root(m), "chosen/bootargs")),
+		  "console=ttyS0");
+	EXPECT_FALSE(is_compatible(s, "ns16550"));
+	EXPECT_EQ(try_get_node(root(m), "soc/serial").error(),
+		  fdt::errc::ambiguous_path);
+	EXPECT_EQ(try_get_property(root(m), "soc/nothing").error(),
+		  fdt::errc::not_found);
+	EXPECT_THROW(get_node(root(m), "soc//serial@1000"), std::invalid_argument);
+	EXPECT_THROW(get_node(root(m), "nothing"), std::bad_optional_access);
+	EXPECT_THROW(as_string(get_property(root(m), "soc/#size-cells")),
+		     std::invalid_argument);
+	EXPECT_THROW(reg(root(m)), std::invalid_argument);
+
+	/* loading directly builds the same tables */
+	const auto &b{save(f)};
+	const auto &l{fdt::load_compact(b)};
+	expect_same(static_dtb::root, root(l));
+	EXPECT_EQ(l.size(), m.size());
+
+	/* including from a blob whose properties are not sorted by name */
+	const auto &[pf, pb]{fdt::load_keep("properties.dtb")};
+	const auto &pc{compact(pf)};
+	const auto &pl{fdt::load_compact(pb)};
+	expect_same(root(pc), root(pl));
+	EXPECT_EQ(pl.size(), pc.size());
+}
+
+TEST(fdt, freeze)
+{
+	const auto &f{fdt::load("static.dtb")};
+	const auto &z{freeze(f)};
+	const auto r{root(z)};
+
+	/* nodes are in pre-order */
+	std::vector<std::string_view> expect, names;
+	for (const auto &[p, depth] : preorder(root(f)))
+		if (is_node(p))
+			expect.push_back(name(p));
+	for (const auto n : subtree(r))
+		names.push_back(name(n));
+	EXPECT_EQ(names, expect);
+
+	/* so a subtree is a contiguous run of records */
+	const auto soc{get_node(r, "soc")};
+	EXPECT_EQ(subtree(soc).size(), 3u);
+	EXPECT_EQ(*subtree(soc).begin(), soc);
+	std::vector<std::string_view> disabled;
+	for (const auto n : subtree(r))
+		if (const auto &s{try_get_property(n, "status")};
+		    s && as_string(*s) == "disabled")
+			disabled.push_back(name(n));
+	EXPECT_EQ(disabled, std::vector<std::string_view>{"serial@2000"});
+
+	names.clear();
+	for (const auto n : subnodes(r))
+		names.push_back(name(n));
+	EXPECT_EQ(names, (std::vector<std::string_view>{"__symbols__", "chosen",
+							"soc"}));
+	EXPECT_TRUE(subnodes(get_node(r, "chosen")).empty());
+	EXPECT_EQ(properties(soc).size(), 4u);
+
+	const auto s{get_node(r, "soc/serial@2000")};
+	EXPECT_EQ(parent(s), soc);
+	EXPECT_EQ(reg(s), (std::vector<fdt::region>{{0x40002000, 0x100},
+						    {0x40003000, 0x100}}));
+	EXPECT_TRUE(is_compatible(s, "ns16550a"));
+	EXPECT_EQ(as<uint32_t>(get_property(r, "soc/serial@1000/clock-frequency")),
+		  48000000u);
+	EXPECT_EQ(as_string(get_property(r, "chosen/bootargs")), "console=ttyS0");
+	EXPECT_EQ(try_get_node(r, "soc/serial").error(),
+		  fdt::errc::ambiguous_path);
+	EXPECT_THROW(get_node(r, "soc/nothing"), std::bad_optional_access);
+	EXPECT_THROW(get_property(r, "soc/"), std::invalid_argument);
+
+	/* unfreezing gives back an equal mutable tree */
+	auto u{unfreeze(z)};
+	EXPECT_EQ(u, f);
+	add_node(root(u), "new");
+	EXPECT_NE(u, f);
+}
+
+TEST(fdt, select)
+{
+	auto f{fdt::load("path.dtb")};
+	set(get_property(f, "/l1@2/reg"), "okay");
+	add_property(get_node(f, "/l1@2/l2@1"), "compatible",
+		     std::vector<std::string_view>{"vendor,l2", "generic"});
+	const auto &fc{f};
+
+	auto paths = [](const auto &v) {
+		std::vector<std::string> r;
+		for (const auto &p : v)
+			r.push_back(path(p));
+		return r;
+	};
+	using V = std::vector<std::string>;
+
+	EXPECT_EQ(paths(select(fc, fdt::selector{"/l1@*"})), (V{"/l1@1", "/l1@2"}));
+	EXPECT_EQ(paths(select(f, fdt::selector{"/*/reg"})), (V{"/l1@1/reg", "/l1@2/reg"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"//reg"})),
+		  (V{"/l1@1/reg", "/l1@1/l2@1/reg", "/l1@2/reg", "/l1@2/l2@1/reg"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"//l2@?/*-prop"})),
+		  (V{"/l1@1/l2@1/l1#1-l2#1-prop", "/l1@2/l2@1/l1#2-l2#1-prop"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"/l1@*//l2@1"})),
+		  (V{"/l1@1/l2@1", "/l1@2/l2@1"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"*[reg=\"okay\"]"})), (V{"/l1@2"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"//*[compatible=\"generic\"][reg]"})),
+		  (V{"/l1@2/l2@1"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"//*[compatible=\"l2\"]"})), V{});
+	EXPECT_EQ(paths(select(fc, fdt::selector{"l1@2/l2@1[compatible]/reg"})),
+		  (V{"/l1@2/l2@1/reg"}));
+	EXPECT_EQ(paths(select(fc, fdt::selector{"/"})), (V{"/"}));
+	EXPECT_EQ(paths(select(get_node(fc, "/l1@1"), fdt::selector{"*"})),
+		  (V{"/l1@1/#address-cells", "/l1@1/#size-cells", "/l1@1/reg", "/l1@1/l2@1"}));
+
+	/* matches at several depths are returned once, in preorder */
+	auto &l2{get_node(f, "/l1@1/l2@1")};
+	add_property(add_node(add_node(l2, "l1@3"), "l2@2"), "reg", 0u);
+	EXPECT_EQ(paths(select(fc, fdt::selector{"//l1@*/*"})),
+		  (V{"/l1@1/#address-cells", "/l1@1/#size-cells", "/l1@1/reg",
+		     "/l1@1/l2@1", "/l1@1/l2@1/l1@3/l2@2",
+		     "/l1@2/#address-cells", "/l1@2/#size-cells", "/l1@2/reg",
+		     "/l1@2/l2@1"}));
+
+	/* compiled selectors can be reused across trees */
+	const fdt::selector s{"//l2@1"};
+	const auto &l{fdt::load("path.dtb")};
+	EXPECT_EQ(size(select(l, s)), 2u);
+	EXPECT_EQ(size(select(f, s)), 2u);
+
+	for (const auto &b : {"///a", "a//", "a[", "a[]", "a[b=c]", "a[b=\"c]", "a[b]c", "[b]"})
+		EXPECT_THROW(fdt::selector{b}, std::invalid_argument) << b;
+}
+
+/*
+ * failing_resource - memory resource which fails allocations while fail is set
+ */
+class failing_resource : public std::pmr::memory_resource {
+public:
+	bool fail{false};
+
+private:
+	void *do_allocate(size_t n, size_t a) override
+	{
+		if (fail)
+			throw std::bad_alloc{};
+		return std::pmr::new_delete_resource()->allocate(n, a);
+	}
+
+	void do_deallocate(void *p, size_t n, size_t a) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, n, a);
+	}
+
+	bool do_is_equal(const memory_resource &o) const noexcept override
+	{
+		return this == &o;
+	}
+};
+
+TEST(fdt, try_find)
+{
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+
+	/* try_find(fdt &), try_find(const fdt &) */
+	EXPECT_EQ(name(try_find(f, "/l1@1/reg")->get()), "reg");
+	EXPECT_EQ(name(try_find(fc, "/l1@1/l2")->get()), "l2@1");
+	EXPECT_EQ(try_find(f, "/x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_find(fc, "/l1@1//l2").error(), fdt::errc::bad_path);
+	EXPECT_EQ(try_find(f, "x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_find(f, "&x/y").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_find(f, "").error(), fdt::errc::bad_path);
+
+	/* try_find(node &), try_find(const node &) */
+	EXPECT_EQ(name(try_find(root(f), "l1@2/l2@1")->get()), "l2@1");
+	EXPECT_EQ(try_find(root(fc), "l1@2/x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_find(root(f), "/x").error(), fdt::errc::bad_path);
+
+	/* failure to rebuild the alias index is returned */
+	failing_resource r;
+	auto g{fdt::load("path.dtb", &r)};
+	add_property(add_node(root(g), "aliases"), "l1", "/l1@1");
+	r.fail = true;
+	EXPECT_EQ(try_find(g, "l1").error(), fdt::errc::no_index);
+	EXPECT_EQ(try_get_node(std::as_const(g), "l1").error(),
+		  fdt::errc::no_index);
+	EXPECT_EQ(name(try_find(g, "/l1@1")->get()), "l1@1");
+	EXPECT_THROW(find(g, "l1"), std::bad_alloc);
+	r.fail = false;
+	EXPECT_EQ(name(try_find(g, "l1")->get()), "l1@1");
+}
+
+TEST(fdt, try_get_node)
+{
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+
+	EXPECT_EQ(&try_get_node(f, "/l1@2/l2@1")->get(), &get_node(f, "/l1@2/l2@1"));
+	EXPECT_EQ(&try_get_node(fc, "/l1@2")->get(), &get_node(fc, "/l1@2"));
+	EXPECT_EQ(try_get_node(f, "/x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_get_node(fc, "x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_get_node(f, "/l1@2/reg").error(), fdt::errc::not_node);
+	EXPECT_EQ(&try_get_node(root(f), "l1@1/l2")->get(), &get_node(f, "/l1@1/l2@1"));
+	EXPECT_EQ(try_get_node(root(fc), "l1@1/reg").error(), fdt::errc::not_node);
+}
+
+TEST(fdt, try_get_property)
+{
+	auto f{fdt::load("path.dtb")};
+	const auto &fc{f};
+
+	EXPECT_EQ(as<uint32_t>(try_get_property(f, "/l1@2/reg")->get()), 2u);
+	EXPECT_EQ(as<uint32_t>(try_get_property(fc, "/l1@1/l2/reg")->get()), 1u);
+	EXPECT_EQ(try_get_property(f, "/l1@2/x").error(), fdt::errc::not_found);
+	EXPECT_EQ(try_get_property(fc, "/l1@2//reg").error(), fdt::errc::bad_path);
+	EXPECT_EQ(try_get_property(f, "/l1@2").error(), fdt::errc::not_property);
+	EXPECT_EQ(as<uint32_t>(try_get_property(root(f), "l1@2/reg")->get()), 2u);
+	EXPECT_EQ(try_get_property(root(fc), "l1@2/l2@1").error(), fdt::errc::not_property);
+}
+
+TEST(property, try_as)
+{
+	const auto &f{fdt::load("properties.dtb")};
+
+	EXPECT_EQ(*try_as<uint32_t>(get_property(f, "/property-u32")), 32u);
+	EXPECT_EQ(*try_as<uint64_t>(get_property(f, "/property-u64")), 64u);
+	EXPECT_EQ(try_as<uint32_t>(get_property(f, "/property-u64")).error(), fdt::errc::incompatible_type);
+	EXPECT_EQ(try_as<uint32_t>(get_property(f, "/property-empty")).error(), fdt::errc::incompatible_type);
+	EXPECT_EQ(*try_as_string(get_property(f, "/property-string")), "hello world!");
+	EXPECT_EQ(try_as_string(get_property(f, "/property-stringlist")).error(), fdt::errc::incompatible_type);
+	EXPECT_EQ(try_as_string(get_property(f, "/property-u32")).error(), fdt::errc::incompatible_type);
+}